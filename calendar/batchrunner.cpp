@@ -0,0 +1,112 @@
+#include "batchrunner.hh"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+double BatchResult::commands_per_second() const
+{
+    if (seconds <= 0)
+        return 0;
+    return commands / seconds;
+}
+
+ScriptReader::ScriptReader(istream& script, BufferedWriter& output):
+    script_(script), output_(output)
+{
+}
+
+int ScriptReader::sync_points() const
+{
+    return sync_points_;
+}
+
+/* Checks for more input without giving it to the Cli yet. */
+bool ScriptReader::finished()
+{
+    if (gptr() != egptr() || has_pending_)
+        return false;
+
+    has_pending_ = read_line();
+    return !has_pending_;
+}
+
+/* If the Cli still has input left from the previous line, it does not
+ * ask for more and its prompt can not be told from the output, so
+ * the prompt is kept.
+ */
+void ScriptReader::start_command()
+{
+    prompt_pending_ = gptr() == egptr();
+    prompt_start_ = output_.position();
+}
+
+/* The first time a command asks for input, the Cli has printed only
+ * its prompt since the command started, and it is dropped.
+ */
+ScriptReader::int_type ScriptReader::underflow()
+{
+    if (prompt_pending_)
+    {
+        output_.discard_from(prompt_start_);
+        prompt_pending_ = false;
+    }
+
+    if (!has_pending_ && !read_line())
+        return traits_type::eof();
+
+    has_pending_ = false;
+    setg(&line_[0], &line_[0], &line_[0] + line_.size());
+    return traits_type::to_int_type(line_[0]);
+}
+
+/* Reads the next command line, handling the sync points before it. */
+bool ScriptReader::read_line()
+{
+    while (getline(script_, line_))
+    {
+        // scripts written on Windows have CRLF line breaks
+        if (!line_.empty() && line_.back() == '\r')
+            line_.pop_back();
+
+        if (line_ == SYNC_LINE)
+        {
+            output_.flush();
+            sync_points_++;
+            continue;
+        }
+
+        line_.push_back('\n');
+        return true;
+    }
+    return false;
+}
+
+/* Runs a command per exec_prompt() call while the script has input. */
+BatchResult run_batch(Cli& cli, istream& script, BufferedWriter& output)
+{
+    BatchResult result;
+    ScriptReader reader(script, output);
+
+    streambuf* old_input = cin.rdbuf(&reader);
+    streambuf* old_output = cout.rdbuf(&output);
+    cin.clear();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while (!reader.finished())
+    {
+        result.commands++;
+        reader.start_command();
+        if (cli.exec_prompt())
+            break;
+    }
+    chrono::duration<double> duration = chrono::steady_clock::now() - start;
+
+    cin.rdbuf(old_input);
+    cout.rdbuf(old_output);
+
+    result.seconds = duration.count();
+    result.sync_points = reader.sync_points();
+    result.output_ok = output.flush();
+    return result;
+}
@@ -0,0 +1,104 @@
+/*
+ * Batch mode of the calendar program. Commands are read from
+ * a script (a file or a pipe) and run with the same Cli as
+ * the interactive program, but all output goes to one large
+ * BufferedWriter that is written at the end or at the sync
+ * points of the script. What the Cli prints before it reads
+ * a command is its prompt, and it is left out of the output.
+ * Everything printed by the commands is kept, also lines
+ * that have no line break yet.
+ *
+ * A script line that only contains SYNC is a sync point: the
+ * output so far is written out and the line is not given to
+ * the Cli.
+ */
+
+#ifndef BATCHRUNNER_HH
+#define BATCHRUNNER_HH
+
+#include "cli.hh"
+#include "bufferedwriter.hh"
+
+#include <istream>
+#include <streambuf>
+#include <string>
+
+// script line that writes out the buffered output
+const std::string SYNC_LINE = "SYNC";
+
+struct BatchResult
+{
+    int commands = 0;
+    int sync_points = 0;
+    double seconds = 0;
+    // false if writing the output failed
+    bool output_ok = true;
+
+    /**
+     * @brief commands_per_second
+     * @return throughput of the run
+     */
+    double commands_per_second() const;
+};
+
+/*
+ * ScriptReader is the input stream buffer given to the Cli.
+ * It hands the script to the Cli one line at a time, so sync
+ * points are handled exactly when the Cli gets to them.
+ */
+class ScriptReader : public std::streambuf
+{
+public:
+    /**
+     * @brief ScriptReader
+     * @param script where the lines are read from
+     * @param output flushed at sync points, prompts are dropped from it
+     */
+    ScriptReader(std::istream& script, BufferedWriter& output);
+
+    /**
+     * @brief start_command marks the start of the output of the next
+     * command. The output until the Cli asks for input is its prompt.
+     */
+    void start_command();
+
+    /**
+     * @brief finished
+     * @return true if the script has no more commands
+     */
+    bool finished();
+
+    int sync_points() const;
+
+protected:
+    // gives the next line of the script
+    int_type underflow() override;
+
+private:
+    std::istream& script_;
+    BufferedWriter& output_;
+    // current line with its line break
+    std::string line_;
+    // true if line_ is read but not yet given to the Cli
+    bool has_pending_ = false;
+    int sync_points_ = 0;
+    // output position where the Cli started to print its prompt
+    std::size_t prompt_start_ = 0;
+    // true from start_command() until the Cli asks for input
+    bool prompt_pending_ = false;
+
+    // reads the next line that is not a sync point to line_
+    bool read_line();
+};
+
+/**
+ * @brief run_batch runs the commands of a script until the script
+ * ends or the Cli quits. cin and cout are redirected during the run.
+ * @param cli the Cli that runs the commands
+ * @param script commands, one per line
+ * @param output where the output of the commands is collected
+ * @return amount of commands, sync points and the duration of the run
+ */
+BatchResult run_batch(Cli& cli, std::istream& script, BufferedWriter& output);
+
+#endif // BATCHRUNNER_HH
@@ -0,0 +1,101 @@
+#include "bufferedwriter.hh"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+using namespace std;
+
+BufferedWriter::BufferedWriter(int fd, size_t capacity):
+    fd_(fd), buffer_(capacity > 0 ? capacity : 1)
+{
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    flush();
+}
+
+/* Writes the whole buffer, continuing after partial writes. */
+bool BufferedWriter::flush()
+{
+    const char* data = pbase();
+    size_t left = pptr() - pbase();
+    while (left > 0 && good_)
+    {
+        ssize_t written = ::write(fd_, data, left);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            good_ = false;
+            break;
+        }
+        data += written;
+        left -= written;
+        bytes_written_ += written;
+    }
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    return good_;
+}
+
+size_t BufferedWriter::position() const
+{
+    return bytes_written_ + (pptr() - pbase());
+}
+
+/* Only buffered output can be taken back. */
+bool BufferedWriter::discard_from(size_t position)
+{
+    if (position < bytes_written_ || position > this->position())
+        return false;
+
+    pbump(-(int)(this->position() - position));
+    return true;
+}
+
+size_t BufferedWriter::bytes_written() const
+{
+    return bytes_written_;
+}
+
+bool BufferedWriter::good() const
+{
+    return good_;
+}
+
+/* Called when the buffer is full. */
+BufferedWriter::int_type BufferedWriter::overflow(int_type ch)
+{
+    if (!flush())
+        return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+/* Copies the text to the buffer, flushing it whenever it gets full. */
+streamsize BufferedWriter::xsputn(const char* text, streamsize count)
+{
+    streamsize copied = 0;
+    while (copied < count)
+    {
+        if (pptr() == epptr() && !flush())
+            break;
+
+        streamsize chunk = min<streamsize>(count - copied, epptr() - pptr());
+        memcpy(pptr(), text + copied, chunk);
+        pbump((int)chunk);
+        copied += chunk;
+    }
+    return copied;
+}
+
+int BufferedWriter::sync()
+{
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * BufferedWriter is an output stream buffer that collects
+ * all output to one large buffer and writes it to a file
+ * descriptor only when the buffer is full or when flush()
+ * is called. Unlike the buffer of cout, it ignores sync
+ * requests (std::endl, std::flush), so printing line by
+ * line does not cause a write per line.
+ *
+ * The writer can be installed to cout with rdbuf() or
+ * used through its own std::ostream.
+ */
+
+#ifndef BUFFEREDWRITER_HH
+#define BUFFEREDWRITER_HH
+
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+class BufferedWriter : public std::streambuf
+{
+public:
+    /**
+     * @brief BufferedWriter
+     * @param fd file descriptor where the output is written
+     * @param capacity size of the buffer in bytes
+     */
+    explicit BufferedWriter(int fd, std::size_t capacity = 1 << 22);
+
+    // writes what is left in the buffer
+    ~BufferedWriter() override;
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    /**
+     * @brief flush writes the buffered output to the file descriptor
+     * @return false if writing failed
+     */
+    bool flush();
+
+    /**
+     * @brief position
+     * @return amount of bytes given to the writer so far, written or not
+     */
+    std::size_t position() const;
+
+    /**
+     * @brief discard_from removes the output given after the position
+     * @param position a value returned by position()
+     * @return false if the output after the position is already written
+     */
+    bool discard_from(std::size_t position);
+
+    /**
+     * @brief bytes_written
+     * @return amount of bytes written to the file descriptor so far
+     */
+    std::size_t bytes_written() const;
+
+    // false after a failed write
+    bool good() const;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* text, std::streamsize count) override;
+    // no-op, output is written only by flush()
+    int sync() override;
+
+private:
+    int fd_;
+    std::vector<char> buffer_;
+    std::size_t bytes_written_ = 0;
+    bool good_ = true;
+};
+
+#endif // BUFFEREDWRITER_HH
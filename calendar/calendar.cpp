@@ -1,358 +1,1598 @@
-#include "calendar.hh"
-#include <iostream>
-#include <iomanip>
-#include <algorithm>
-
-
-using namespace std;
-
-Calendar::Calendar()
-{
-
-}
-
-/* A helper function that sorts events by time.
- * Returns true if event1 should come before event2.
- */
-bool compare_events_by_time(const shared_ptr<Event>& event1, const shared_ptr<Event>& event2)
-{
-    if (event1->start() != event2->start()) {
-        return event1->start() < event2->start();
-    }
-    return event1->end() < event2->end();
-}
-/* A helper function that sorts events for a given date. */
-void Calendar::sort_events(Date date)
-{
-    map<Date, vector<shared_ptr<Event>>>::iterator iter = events_.find(date);
-    // get hold of events in todays date
-    vector<shared_ptr<Event>>& events_today = iter->second;
-
-    // sorting events by their time
-    sort(events_today.begin(), events_today.end(), compare_events_by_time);
-}
-
-/* Constructs and adds an event for the current date.
- * Returns false if times are invalid or start >= end.
- */
-bool Calendar::add_event(std::string name, Time::Minutes start, Time::Minutes end,
-               std::string description)
-{
-    // Invalid input handling
-    if(start >= end)
-    {
-        cout << "Error: invalid time(s)." << endl;;
-        return false;
-    }
-    if(!Time::is_valid(start) || !Time::is_valid(end))
-    {
-        cout << "Error: invalid time(s)." << endl;;
-        return false;
-    }
-
-    // create an instance of an event and add it
-    shared_ptr new_event = make_shared<Event>(
-        chosen_date_, name, start, end, description
-        );
-    events_[chosen_date_].push_back(new_event);
-
-    // sort events
-    sort_events(chosen_date_);
-    return true;
-}
-bool Calendar::add_event(std::string name, Time::Minutes start, Time::Minutes end,
-                         std::string description, Date date_for_event)
-{
-    // Invalid input handling
-    if(start >= end)
-    {
-        cout << "Error: invalid time(s)." << endl;;
-        return false;
-    }
-    if(!Time::is_valid(start) || !Time::is_valid(end))
-    {
-        cout << "Error: invalid time(s)." << endl;;
-        return false;
-    }
-
-    // create an instance of an event and add it
-    shared_ptr new_event = make_shared<Event>(
-        chosen_date_, name, start, end, description
-        );
-    events_[date_for_event].push_back(new_event);
-
-    // sort events
-    sort_events(date_for_event);
-    return true;
-}
-
-
-/* Changes the currently chosen date. */
-void Calendar::change_date(Date new_date)
-{
-    // check if new_date is not valid
-    if(!Date::is_valid_date(chosen_date_.day(), chosen_date_.month(), chosen_date_.year()))
-    {
-        // return the function and print error message
-        cout << "Error: incorrect parameter." << endl;
-        return;
-    }
-
-    // if the new date is valid set chosen date to new date
-    chosen_date_ = new_date;
-}
-
-/* Changes the currently chosen date's month, keeping day/year where possible. */
-bool Calendar::change_month(int month)
-{
-    // check if new date is not valid
-    if(!Date::is_valid_date(chosen_date_.day(), month, chosen_date_.year()))
-    {
-        // the day is outside of new month. Update it
-        int month_last_day = Date::days_in_month(month, chosen_date_.year());
-        Date new_date(month_last_day, month, chosen_date_.year());
-        chosen_date_ = new_date;
-        return true;
-    }
-
-    // create a new date where only month is changed
-    Date new_date(chosen_date_.day(), month, chosen_date_.year());
-
-    // if the new date is valid set chosen date to new date
-    chosen_date_ = new_date;
-    return true;
-}
-
-/* Changes the currently chosen date's day, within the same month/year. */
-bool Calendar::change_day(int day)
-{
-    // check if new date is not valid
-    if(!Date::is_valid_date(day, chosen_date_.month(), chosen_date_.year()))
-    {
-        // return the function and print error message
-        return false;
-    }
-
-    // create a new date where only day is changed
-    Date new_date(day, chosen_date_.month(), chosen_date_.year());
-
-    // if the new date is valid set chosen date to new date
-    chosen_date_ = new_date;
-    return true;
-}
-
-/* Prints out a calendar view of the current month. */
-void Calendar::print_month()
-{
-    cout << "  Mo  Tu  We  Th  Fr  Sa  Su\n";
-
-    // get first day of month
-    Date first_day_date(1, chosen_date_.month(), chosen_date_.year());
-    int first_day = first_day_date.day_of_week();
-    // sunday = 0
-    if(first_day <= 0)
-    {
-        first_day = 7;
-    }
-
-    // offset to the first day
-    for (int i = 0; i < first_day - 1; ++i) {
-        cout << std::string(4, ' ');
-    }
-
-    // helper int to set correct layout for the calendar.
-    int current_week_day = first_day - 1;
-    if(current_week_day <= 0)
-    {
-        current_week_day = 6;
-    }
-
-    // print days
-    for (int day = 1; day <= Date::days_in_month(chosen_date_.month(), chosen_date_.year()); ++day)
-    {
-        bool printed = false;
-
-        // is used for correct width setting.
-        int width = day >= 10 ? 2 : 3;
-
-        // check if day is current day
-        if(day == chosen_date_.day())
-        {
-            cout << setw(width)<< '^' << day;
-            printed = true;
-        }
-        // check if day has events
-        else
-        {
-            // check if the day has events
-            Date current_date(day, chosen_date_.month(), chosen_date_.year());
-            map<Date, vector<shared_ptr<Event>>>::iterator iter = events_.find(current_date);
-            if (iter != events_.end() && !iter->second.empty())
-            {
-                cout  << setw(width)<< '*' << day;
-                printed = true;
-            }
-        }
-
-        if(!printed)
-            cout << setw(4) << day;
-
-        // if reached sunday then end the line and go to monday
-        current_week_day++;
-        if(current_week_day == 7)
-        {
-            current_week_day = 0;
-            cout << endl;
-        }
-    }
-
-    // if month didnt end on sunday add one extra line
-    if(current_week_day != 0)
-        cout << endl;
-}
-
-
-
-/* Prints out the schedule for the current date's events. */
-void Calendar::print_day()
-{
-    // finds events for currently chosen date
-    map<Date, vector<shared_ptr<Event>>>::iterator iter = events_.find(chosen_date_);
-    if (iter == events_.end() || iter->second.empty()) {
-        cout << "No events for the day." << endl;
-        return;
-    }
-
-    // now we can get todays events from iterator
-    vector<shared_ptr<Event>> events_today = iter->second;
-
-    int current_event = 1;
-    for(const shared_ptr<Event>& event : events_today)
-    {
-        cout << '(' << current_event << ") " <<
-            Time::to_string(event->start()) << " - " <<
-            Time::to_string(event->end()) <<
-            " \"" << event->name() << "\"" << endl;
-        current_event++;
-    }
-}
-
-
-/* Prints details of the i:th event of the selected day. */
-bool Calendar::print_event(int i)
-{
-    // early exit
-    if(i <= 0)
-        return false;
-
-    map<Date, vector<shared_ptr<Event>>>::iterator iter = events_.find(chosen_date_);
-    // no events in the day
-    if (iter == events_.end() || iter->second.empty()) {
-        return false;
-    }
-
-    const vector<shared_ptr<Event>>& events_today = iter->second;
-
-    // check if i is inside the events vector
-    if(i > (int)size(events_today))
-        return false;
-
-    const shared_ptr<Event>& event = events_today.at(i - 1);
-    cout << '\"' << event->name() << "\" from " <<
-        Time::to_string(event->start()) << " to " <<
-        Time::to_string(event->end()) << endl <<
-        "  " << event->description() << endl;
-    return true;
-}
-
-
-/* Deletes the i:th event of the selected day. */
-bool Calendar::delete_event(int i)
-{
-    // early exit
-    if(i <= 0)
-        return false;
-
-    map<Date, vector<shared_ptr<Event>>>::iterator iter = events_.find(chosen_date_);
-    // no events in the day
-    if (iter == events_.end() || iter->second.empty()) {
-        return false;
-    }
-
-    vector<shared_ptr<Event>>& events_today = iter->second;
-
-    // check if i is inside the events vector
-    if(i > (int)size(events_today))
-        return false;
-
-    // delete event from events
-    events_today.erase(events_today.begin() + (i - 1));
-
-    //additionaly if there are no more events in the day, remove the whole Date from map
-    if (events_today.empty()) {
-        events_.erase(iter);
-    }
-
-    return true;
-}
-
-
-/* Moves the i:th event of the selected day to a new date. */
-bool Calendar::move_event(int i, Date new_date)
-{
-    // early exit
-    if(i <= 0)
-        return false;
-
-    map<Date, vector<shared_ptr<Event>>>::iterator iter = events_.find(chosen_date_);
-    // no events in the day
-    if (iter == events_.end() || iter->second.empty()) {
-        return false;
-    }
-
-    const vector<shared_ptr<Event>>& events_today = iter->second;
-
-    // check if i is inside the events vector
-    if(i > (int)size(events_today))
-        return false;
-
-    const shared_ptr<Event>& event = events_today.at(i - 1);
-
-    // check if time is valid
-    if(!Date::is_valid_date(new_date.day(), new_date.month(), new_date.year()))
-    {
-        return false;
-    }
-
-    // set new date to the event
-    event->set_date(new_date);
-
-    // add event to the moved date
-    add_event(event->name(), event->start(), event->end(), event->description(), new_date);
-
-    // delete event from the current day
-    delete_event(i);
-
-
-    return true;
-}
-
-
-/* Getter for the currently chosen date. */
-Date Calendar::chosen_date()
-{
-    return chosen_date_;
-}
-/* Getter for the events count. */
-
-int Calendar::events_count(Date date)
-{
-    map<Date, vector<shared_ptr<Event>>>::iterator iter = events_.find(date);
-    // no events in the day
-    if (iter == events_.end() || iter->second.empty()) {
-        return 0;
-    }
-
-    const vector<shared_ptr<Event>>& events_today = iter->second;
-    return (int)size(events_today);
-}
+#include "calendar.hh"
+#include "dayordinal.hh"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+
+
+using namespace std;
+
+// expanded days kept before the days that only have occurrences are
+// dropped by a range query
+const size_t MAX_EXPANDED_DAYS = 4096;
+
+Calendar::Calendar():
+    expanded_limit_(MAX_EXPANDED_DAYS)
+{
+    // a deleted event that can not be undone any more frees its slot
+    history_.set_drop_handler([this](EventId id) { reclaim_event(id); });
+}
+
+/* Checks that event times are valid and start is before end. */
+static bool are_valid_times(Time::Minutes start, Time::Minutes end)
+{
+    return start < end && Time::is_valid(start) && Time::is_valid(end);
+}
+
+/* Returns the key of the month in month_summaries_. */
+static int month_key(int month, int year)
+{
+    return year * 12 + month - 1;
+}
+
+/* Marks the day in the summary of its month. */
+void Calendar::mark_day(int ordinal)
+{
+    Date date = date_from_ordinal(ordinal);
+    month_summaries_[month_key(date.month(), date.year())] |= 1u << (date.day() - 1);
+}
+
+/* Creates the events of a day that are still only in a snapshot
+ * or in a series that has not been expanded on the day.
+ */
+void Calendar::load_day(int ordinal)
+{
+    map<int, ColdDay>::iterator cold = cold_days_.find(ordinal);
+    if (cold != cold_days_.end())
+    {
+        materialise(ordinal, cold->second);
+        cold_days_.erase(cold);
+    }
+    expand_day(ordinal);
+}
+
+/* Creates the events of a day read from a snapshot. */
+void Calendar::materialise(int ordinal, const ColdDay& cold)
+{
+    Date date = date_from_ordinal(ordinal);
+    vector<DayEntry> entries;
+    for (const SnapshotEvent& event : cold.reader->read_day(cold.index))
+    {
+        EventId id = create_event(date, event.name, event.start, event.end,
+                                  event.description);
+        entries.push_back({event.start, event.end, id});
+    }
+    // events are stored in time order, so the batch merges without sorting
+    events_[ordinal].insert_batch(std::move(entries));
+}
+
+/* Creates the events of every cold day between the ordinals. */
+void Calendar::load_days(int first, int last)
+{
+    map<int, ColdDay>::iterator cold = cold_days_.lower_bound(first);
+    while (cold != cold_days_.end() && cold->first <= last)
+    {
+        materialise(cold->first, cold->second);
+        cold = cold_days_.erase(cold);
+    }
+    expand_days(first, last);
+}
+
+/* Creates events for occurrences of the series added after the day
+ * was last expanded. The events are only a cache of the series, so
+ * nothing is recorded. Each series is expanded on a day only once,
+ * and deleting or moving an occurrence makes it an exception, so it
+ * does not come back. Days without occurrences are remembered too,
+ * so using a day again does not go through the series.
+ */
+void Calendar::expand_day(int ordinal)
+{
+    if (series_.empty())
+        return;
+
+    map<int, size_t>::iterator expanded = expanded_series_.find(ordinal);
+    size_t series = expanded == expanded_series_.end() ? 0 : expanded->second;
+    if (series == series_.size())
+        return;
+    for (; series < series_.size(); ++series)
+    {
+        const Recurrence& recurrence = series_.at(series);
+        if (!recurrence.occurs_on(ordinal))
+            continue;
+
+        EventId id = create_event(date_from_ordinal(ordinal), recurrence.name(),
+                                  recurrence.start(), recurrence.end(),
+                                  recurrence.description());
+        map<int, DayEvents>::iterator day = events_.find(ordinal);
+        if (day == events_.end())
+        {
+            mark_day(ordinal);
+            day = events_.insert({ordinal, DayEvents()}).first;
+        }
+        day->second.insert({recurrence.start(), recurrence.end(), id, true});
+        occurrences_.insert({id, (int)series});
+    }
+
+    if (expanded != expanded_series_.end())
+        expanded->second = series_.size();
+    else
+        expanded_series_.insert({ordinal, series_.size()});
+}
+
+/* The days that only have occurrences are a cache of the series, so
+ * when many days have been expanded, the ones outside the range are
+ * dropped and expanded again when they are used. Days with stored
+ * events or reminders not yet given are kept. Expanding twice as many
+ * days as are kept before the next drop keeps the cost per day constant.
+ */
+void Calendar::drop_expanded_days(int first, int last)
+{
+    if (expanded_series_.size() <= expanded_limit_)
+        return;
+
+    map<int, size_t>::iterator expanded = expanded_series_.begin();
+    while (expanded != expanded_series_.end())
+    {
+        int ordinal = expanded->first;
+        map<int, DayEvents>::iterator day = events_.find(ordinal);
+        bool keep = (ordinal >= first && ordinal <= last) || cold_days_.count(ordinal) != 0;
+        if (!keep && day != events_.end())
+        {
+            keep = day->second.stored_before(day->second.size()) > 0;
+            for (const DayEntry& entry : day->second)
+                keep = keep || reminders_.contains(entry.id);
+        }
+        if (keep)
+        {
+            ++expanded;
+            continue;
+        }
+
+        if (day != events_.end())
+        {
+            for (const DayEntry& entry : day->second)
+            {
+                occurrences_.erase(entry.id);
+                release_event(entry.id);
+                reclaim_event(entry.id);
+            }
+            // month_summary() finds the day from the series again
+            unmark_day(ordinal);
+            events_.erase(day);
+        }
+        expanded = expanded_series_.erase(expanded);
+    }
+    expanded_limit_ = max(MAX_EXPANDED_DAYS, 2 * expanded_series_.size());
+}
+
+/* Expands the days between the ordinals where some series occurs. */
+void Calendar::expand_days(int first, int last)
+{
+    for (const Recurrence& series : series_)
+    {
+        for (int ordinal : series.occurrences(first, last))
+        {
+            expand_day(ordinal);
+        }
+    }
+}
+
+/* An occurrence that is deleted or moved is left out of its series,
+ * so the journal and snapshots only need the exception.
+ */
+bool Calendar::leave_out_occurrence(EventId id, int ordinal)
+{
+    unordered_map<EventId, int>::iterator occurrence = occurrences_.find(id);
+    if (occurrence == occurrences_.end())
+        return false;
+
+    series_.at(occurrence->second).add_exception(ordinal);
+    JournalRecord record{JournalRecordType::EXCEPTION};
+    record.ordinal = ordinal;
+    record.index = occurrence->second;
+    log(record);
+    occurrences_.erase(occurrence);
+    return true;
+}
+
+/* Occurrences are created again from their series when the journal
+ * is replayed, so they are not counted in the positions it records.
+ * Their day entries are marked cached, and the day counts the others.
+ */
+int Calendar::stored_position(const DayEvents& day, int index) const
+{
+    return day.stored_before(index) + 1;
+}
+
+int Calendar::day_index(const DayEvents& day, int position) const
+{
+    return day.stored_index(position);
+}
+
+/* Finds the events of a day, creating them first if the day is cold. */
+map<int, DayEvents>::iterator Calendar::find_day(int ordinal)
+{
+    load_day(ordinal);
+    return events_.find(ordinal);
+}
+
+/* Gives the events of the day and marks the day in its month summary. */
+DayEvents& Calendar::day_events(int ordinal)
+{
+    map<int, DayEvents>::iterator iter = find_day(ordinal);
+    if (iter != events_.end())
+        return iter->second;
+
+    mark_day(ordinal);
+    return events_[ordinal];
+}
+
+/* Clears the day from the summary of its month. */
+void Calendar::unmark_day(int ordinal)
+{
+    Date date = date_from_ordinal(ordinal);
+    map<int, uint32_t>::iterator summary =
+        month_summaries_.find(month_key(date.month(), date.year()));
+    if (summary == month_summaries_.end())
+        return;
+
+    summary->second &= ~(1u << (date.day() - 1));
+    if (summary->second == 0)
+        month_summaries_.erase(summary);
+}
+
+/* Removes the day if it has no events and unmarks it from the month summary. */
+void Calendar::remove_if_empty(map<int, DayEvents>::iterator day)
+{
+    if (!day->second.empty())
+        return;
+
+    unmark_day(day->first);
+    events_.erase(day);
+}
+
+/* Creates an event to the pool and indexes its words, if the
+ * search index is in use.
+ */
+EventId Calendar::create_event(Date date, string_view name, Time::Minutes start,
+                               Time::Minutes end, string_view description)
+{
+    EventId id = pool_.create(date, name, start, end, description);
+    if (search_index_built_)
+        search_index_.add(id, pool_.get(id));
+    update_reminder(id);
+    return id;
+}
+
+void Calendar::release_event(EventId id)
+{
+    if (search_index_built_)
+        search_index_.remove(id, pool_.get(id));
+    reminders_.remove(id);
+    pool_.release(id);
+}
+
+/* A text freed from the pool may later be given to another text at
+ * the same address, so the search index forgets its words.
+ */
+void Calendar::reclaim_event(EventId id)
+{
+    const Event& event = pool_.get(id);
+    const string* texts[] = {&event.name(), &event.description()};
+    pool_.reclaim(id);
+    if (!search_index_built_)
+        return;
+    for (const string* text : texts)
+    {
+        if (!pool_.strings().contains(text))
+            search_index_.forget_text(text);
+    }
+}
+
+void Calendar::set_event_date(EventId id, Date new_date)
+{
+    Event& event = pool_.get(id);
+    if (search_index_built_)
+        search_index_.move(id, event, day_ordinal(new_date));
+    event.set_date(new_date);
+    update_reminder(id);
+}
+
+/* Constructs and adds an event for the current date.
+ * Returns false if times are invalid or start >= end.
+ */
+bool Calendar::add_event(std::string name, Time::Minutes start, Time::Minutes end,
+               std::string description)
+{
+    return add_event(name, start, end, description, chosen_date_);
+}
+bool Calendar::add_event(std::string name, Time::Minutes start, Time::Minutes end,
+                         std::string description, Date date_for_event)
+{
+    // Invalid input handling
+    if(!are_valid_times(start, end))
+    {
+        cout << "Error: invalid time(s)." << '\n';
+        return false;
+    }
+
+    // create an instance of an event and add it to its sorted place
+    EventId id = create_event(date_for_event, name, start, end, description);
+    day_events(day_ordinal(date_for_event)).insert({start, end, id});
+    history_.record(HistoryAction::REMOVE, id);
+
+    log_add(day_ordinal(date_for_event), start, end, name, description);
+    return true;
+}
+
+/* Adds many events at once. Events are grouped by their date
+ * and each day is sorted only once.
+ * Returns the amount of events added.
+ */
+int Calendar::add_events(vector<EventData> events)
+{
+    map<int, vector<DayEntry>> batches;
+    int added = 0;
+    history_.begin_group();
+    for(EventData& event : events)
+    {
+        // skip events with invalid times
+        if(!are_valid_times(event.start, event.end))
+            continue;
+
+        int ordinal = day_ordinal(event.date);
+        EventId id = create_event(event.date, event.name, event.start, event.end,
+                                  event.description);
+        batches[ordinal].push_back({event.start, event.end, id});
+        history_.record(HistoryAction::REMOVE, id);
+        added++;
+
+        log_add(ordinal, event.start, event.end, event.name, event.description);
+    }
+
+    history_.end_group();
+
+    for(pair<const int, vector<DayEntry>>& batch : batches)
+    {
+        day_events(batch.first).insert_batch(std::move(batch.second));
+    }
+    return added;
+}
+
+
+/* Adds a repeating event. Only the series is stored here,
+ * occurrences are created when their dates are used.
+ */
+int Calendar::add_recurring_event(string name, Time::Minutes start,
+                                  Time::Minutes end, string description,
+                                  Date first_date, RecurrenceRule rule)
+{
+    if(!are_valid_times(start, end))
+    {
+        cout << "Error: invalid time(s)." << '\n';
+        return -1;
+    }
+
+    JournalRecord record{JournalRecordType::SERIES};
+    record.ordinal = day_ordinal(first_date);
+    record.start = start;
+    record.end = end;
+    record.name = name;
+    record.description = description;
+    record.rule = rule;
+    log(record);
+
+    series_.push_back(Recurrence(first_date, std::move(name), start, end,
+                                 std::move(description), rule));
+
+    // the days reminders already looked at get the new occurrences now
+    if (reminders_started_)
+        expand_days((int)(reminded_until_ / (24 * 60)), reminder_days_loaded_);
+    return (int)series_.size() - 1;
+}
+
+/* Leaves an occurrence out of a series. An occurrence that is already
+ * an event is deleted from its day, which records the exception.
+ */
+bool Calendar::add_recurrence_exception(int series, Date date)
+{
+    if(series < 0 || series >= (int)series_.size())
+        return false;
+
+    int ordinal = day_ordinal(date);
+    map<int, size_t>::iterator expanded = expanded_series_.find(ordinal);
+    map<int, DayEvents>::iterator day = events_.find(ordinal);
+    if(expanded != expanded_series_.end() && expanded->second > (size_t)series &&
+       day != events_.end())
+    {
+        for(int i = 0; i < day->second.size(); ++i)
+        {
+            unordered_map<EventId, int>::const_iterator occurrence =
+                occurrences_.find(day->second.at(i).id);
+            if(occurrence != occurrences_.end() && occurrence->second == series)
+            {
+                // not undoable, so the slot is reused right away
+                EventId id = occurrence->first;
+                delete_at(day, i);
+                reclaim_event(id);
+                return true;
+            }
+        }
+    }
+
+    series_.at(series).add_exception(ordinal);
+    JournalRecord record{JournalRecordType::EXCEPTION};
+    record.ordinal = ordinal;
+    record.index = series;
+    log(record);
+    return true;
+}
+
+/* Changes the currently chosen date. */
+void Calendar::change_date(Date new_date)
+{
+    // check if new_date is not valid
+    if(!Date::is_valid_date(chosen_date_.day(), chosen_date_.month(), chosen_date_.year()))
+    {
+        // return the function and print error message
+        cout << "Error: incorrect parameter." << '\n';
+        return;
+    }
+
+    // if the new date is valid set chosen date to new date
+    chosen_date_ = new_date;
+    log_chosen_date();
+}
+
+/* Changes the currently chosen date's month, keeping day/year where possible. */
+bool Calendar::change_month(int month)
+{
+    // check if new date is not valid
+    if(!Date::is_valid_date(chosen_date_.day(), month, chosen_date_.year()))
+    {
+        // the day is outside of new month. Update it
+        int month_last_day = Date::days_in_month(month, chosen_date_.year());
+        Date new_date(month_last_day, month, chosen_date_.year());
+        chosen_date_ = new_date;
+        log_chosen_date();
+        return true;
+    }
+
+    // create a new date where only month is changed
+    Date new_date(chosen_date_.day(), month, chosen_date_.year());
+
+    // if the new date is valid set chosen date to new date
+    chosen_date_ = new_date;
+    log_chosen_date();
+    return true;
+}
+
+/* Changes the currently chosen date's day, within the same month/year. */
+bool Calendar::change_day(int day)
+{
+    // check if new date is not valid
+    if(!Date::is_valid_date(day, chosen_date_.month(), chosen_date_.year()))
+    {
+        // return the function and print error message
+        return false;
+    }
+
+    // create a new date where only day is changed
+    Date new_date(day, chosen_date_.month(), chosen_date_.year());
+
+    // if the new date is valid set chosen date to new date
+    chosen_date_ = new_date;
+    log_chosen_date();
+    return true;
+}
+
+/* Prints out a calendar view of the current month. */
+void Calendar::print_month()
+{
+    cout << "  Mo  Tu  We  Th  Fr  Sa  Su\n";
+
+    // get first day of month
+    Date first_day_date(1, chosen_date_.month(), chosen_date_.year());
+    int first_day = first_day_date.day_of_week();
+    // sunday = 0
+    if(first_day <= 0)
+    {
+        first_day = 7;
+    }
+
+    // offset to the first day
+    for (int i = 0; i < first_day - 1; ++i) {
+        cout << std::string(4, ' ');
+    }
+
+    // helper int to set correct layout for the calendar.
+    int current_week_day = first_day - 1;
+    if(current_week_day <= 0)
+    {
+        current_week_day = 6;
+    }
+
+    // days of the month that have events
+    uint32_t days_with_events = month_summary(chosen_date_.month(), chosen_date_.year());
+
+    // print days
+    for (int day = 1; day <= Date::days_in_month(chosen_date_.month(), chosen_date_.year()); ++day)
+    {
+        bool printed = false;
+
+        // is used for correct width setting.
+        int width = day >= 10 ? 2 : 3;
+
+        // check if day is current day
+        if(day == chosen_date_.day())
+        {
+            cout << setw(width)<< '^' << day;
+            printed = true;
+        }
+        // check if day has events
+        else
+        {
+            // check if the day has events
+            if (days_with_events & (1u << (day - 1)))
+            {
+                cout  << setw(width)<< '*' << day;
+                printed = true;
+            }
+        }
+
+        if(!printed)
+            cout << setw(4) << day;
+
+        // if reached sunday then end the line and go to monday
+        current_week_day++;
+        if(current_week_day == 7)
+        {
+            current_week_day = 0;
+            cout << '\n';
+        }
+    }
+
+    // if month didnt end on sunday add one extra line
+    if(current_week_day != 0)
+        cout << '\n';
+}
+
+
+
+/* Prints out the schedule for the current date's events. */
+void Calendar::print_day()
+{
+    // finds events for currently chosen date
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(chosen_date_));
+    if (iter == events_.end() || iter->second.empty()) {
+        cout << "No events for the day." << '\n';
+        return;
+    }
+
+    // now we can get todays events from iterator
+    const DayEvents& events_today = iter->second;
+
+    int current_event = 1;
+    for(const DayEntry& entry : events_today)
+    {
+        const Event& event = pool_.get(entry.id);
+        cout << '(' << current_event << ") " <<
+            Time::to_string(event.start()) << " - " <<
+            Time::to_string(event.end()) <<
+            " \"" << event.name() << "\"" << '\n';
+        current_event++;
+    }
+}
+
+
+/* Prints details of the i:th event of the selected day. */
+bool Calendar::print_event(int i)
+{
+    // early exit
+    if(i <= 0)
+        return false;
+
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(chosen_date_));
+    // no events in the day
+    if (iter == events_.end() || iter->second.empty()) {
+        return false;
+    }
+
+    const DayEvents& events_today = iter->second;
+
+    // check if i is inside the events vector
+    if(i > events_today.size())
+        return false;
+
+    const Event& event = pool_.get(events_today.at(i - 1).id);
+    cout << '\"' << event.name() << "\" from " <<
+        Time::to_string(event.start()) << " to " <<
+        Time::to_string(event.end()) << '\n' <<
+        "  " << event.description() << '\n';
+    return true;
+}
+
+
+/* Deletes the i:th event of the selected day. */
+bool Calendar::delete_event(int i)
+{
+    // early exit
+    if(i <= 0)
+        return false;
+
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(chosen_date_));
+    // no events in the day
+    if (iter == events_.end() || iter->second.empty()) {
+        return false;
+    }
+
+    // check if i is inside the events vector
+    if(i > iter->second.size())
+        return false;
+
+    // recorded after the delete, so a dropped entry finds the event released
+    EventId id = iter->second.at(i - 1).id;
+    delete_at(iter, i - 1);
+    history_.record(HistoryAction::RESTORE, id);
+    return true;
+}
+
+
+/* Moves the i:th event of the selected day to a new date. */
+bool Calendar::move_event(int i, Date new_date)
+{
+    // early exit
+    if(i <= 0)
+        return false;
+
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(chosen_date_));
+    // no events in the day
+    if (iter == events_.end() || iter->second.empty()) {
+        return false;
+    }
+
+    // check if i is inside the events vector
+    if(i > iter->second.size())
+        return false;
+
+    // check if time is valid
+    if(!Date::is_valid_date(new_date.day(), new_date.month(), new_date.year()))
+    {
+        return false;
+    }
+
+    history_.record(HistoryAction::MOVE_TO, iter->second.at(i - 1).id, iter->first);
+    move_at(iter, i - 1, new_date);
+    return true;
+}
+
+/* Gives the handle of the i:th event of the selected day. */
+bool Calendar::event_id(int i, EventId& id)
+{
+    if(i <= 0)
+        return false;
+
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(chosen_date_));
+    if (iter == events_.end() || i > iter->second.size())
+        return false;
+
+    id = iter->second.at(i - 1).id;
+    return true;
+}
+
+/* Finds the day and the index of an event from its date and times,
+ * so the event is located without going through its day.
+ */
+bool Calendar::locate(EventId id, map<int, DayEvents>::iterator& day, int& index)
+{
+    if (!pool_.contains(id))
+        return false;
+
+    const Event& event = pool_.get(id);
+    day = find_day(day_ordinal(event.date()));
+    if (day == events_.end())
+        return false;
+
+    index = day->second.find({event.start(), event.end(), id});
+    return index >= 0;
+}
+
+bool Calendar::delete_by_id(EventId id)
+{
+    map<int, DayEvents>::iterator day;
+    int index = 0;
+    if (!locate(id, day, index))
+        return false;
+
+    delete_at(day, index);
+    history_.record(HistoryAction::RESTORE, id);
+    return true;
+}
+
+bool Calendar::move_by_id(EventId id, Date new_date)
+{
+    if(!Date::is_valid_date(new_date.day(), new_date.month(), new_date.year()))
+        return false;
+
+    map<int, DayEvents>::iterator day;
+    int index = 0;
+    if (!locate(id, day, index))
+        return false;
+
+    history_.record(HistoryAction::MOVE_TO, id, day->first);
+    move_at(day, index, new_date);
+    return true;
+}
+
+/* Groups the handles by the day of their event, so every day is
+ * gone through only once however many of its events are changed.
+ */
+map<int, unordered_set<EventId>> Calendar::group_by_day(const vector<EventId>& ids) const
+{
+    map<int, unordered_set<EventId>> days;
+    for (EventId id : ids)
+    {
+        if (pool_.contains(id))
+            days[day_ordinal(pool_.get(id).date())].insert(id);
+    }
+    return days;
+}
+
+/* Deletes the events with one pass over each affected day. */
+int Calendar::delete_events(const vector<EventId>& ids)
+{
+    int deleted = 0;
+    history_.begin_group();
+    for (const pair<const int, unordered_set<EventId>>& ids_of_day : group_by_day(ids))
+    {
+        map<int, DayEvents>::iterator day = find_day(ids_of_day.first);
+        if (day == events_.end())
+            continue;
+
+        vector<DayEntry> removed;
+        vector<int> indices = day->second.remove_ids(ids_of_day.second, removed);
+        for (size_t k = 0; k < removed.size(); ++k)
+        {
+            bool occurrence = leave_out_occurrence(removed.at(k).id, ids_of_day.first);
+            release_event(removed.at(k).id);
+            history_.record(HistoryAction::RESTORE, removed.at(k).id);
+            if (occurrence)
+                continue;
+
+            // the k events before this one are already deleted when replayed
+            JournalRecord record{JournalRecordType::DELETE};
+            record.ordinal = ids_of_day.first;
+            record.index = stored_position(day->second, indices.at(k) - (int)k);
+            log(record);
+        }
+        deleted += (int)removed.size();
+        remove_if_empty(day);
+    }
+    history_.end_group();
+    return deleted;
+}
+
+/* Takes the events out of their days with one pass over each day and
+ * adds them to the new date as one batch.
+ */
+int Calendar::move_events(const vector<EventId>& ids, Date new_date)
+{
+    if(!Date::is_valid_date(new_date.day(), new_date.month(), new_date.year()))
+        return 0;
+
+    int new_ordinal = day_ordinal(new_date);
+    // create the events of the new date first, so the moved ones come after them
+    load_day(new_ordinal);
+
+    vector<DayEntry> moved;
+    history_.begin_group();
+    for (const pair<const int, unordered_set<EventId>>& ids_of_day : group_by_day(ids))
+    {
+        // events already on the new date stay where they are
+        if (ids_of_day.first == new_ordinal)
+            continue;
+
+        map<int, DayEvents>::iterator day = find_day(ids_of_day.first);
+        if (day == events_.end())
+            continue;
+
+        size_t first = moved.size();
+        vector<int> indices = day->second.remove_ids(ids_of_day.second, moved);
+        for (size_t k = 0; k < indices.size(); ++k)
+        {
+            EventId id = moved.at(first + k).id;
+            moved.at(first + k).cached = false;
+            bool occurrence = leave_out_occurrence(id, ids_of_day.first);
+            set_event_date(id, new_date);
+            history_.record(HistoryAction::MOVE_TO, id, ids_of_day.first);
+            if (occurrence)
+            {
+                // the moved occurrence is a normal event from now on
+                const Event& event = pool_.get(id);
+                log_add(new_ordinal, event.start(), event.end(), event.name(),
+                        event.description());
+                continue;
+            }
+
+            JournalRecord record{JournalRecordType::MOVE};
+            record.ordinal = ids_of_day.first;
+            record.index = stored_position(day->second, indices.at(k) - (int)k);
+            record.new_ordinal = new_ordinal;
+            log(record);
+        }
+        remove_if_empty(day);
+    }
+    history_.end_group();
+
+    // same order as moving the events one at a time
+    if (!moved.empty())
+        day_events(new_ordinal).insert_batch(moved);
+    return (int)moved.size();
+}
+
+/* Deletes the event at the index of the day and records the change. */
+void Calendar::delete_at(map<int, DayEvents>::iterator day, int index)
+{
+    int ordinal = day->first;
+    EventId id = day->second.at(index).id;
+    int position = stored_position(day->second, index);
+    bool occurrence = leave_out_occurrence(id, ordinal);
+    release_event(id);
+    day->second.erase(index);
+
+    //additionaly if there are no more events in the day, remove the whole Date from map
+    remove_if_empty(day);
+    if (occurrence)
+        return;
+
+    JournalRecord record{JournalRecordType::DELETE};
+    record.ordinal = ordinal;
+    record.index = position;
+    log(record);
+}
+
+/* Moves the event at the index of the day and records the change.
+ * Only the small day entry is moved, the event stays in its slot.
+ */
+void Calendar::move_at(map<int, DayEvents>::iterator day, int index, Date new_date)
+{
+    int ordinal = day->first;
+
+    // take the event out of the current day
+    DayEntry entry = day->second.at(index);
+    entry.cached = false;
+    int position = stored_position(day->second, index);
+    bool occurrence = leave_out_occurrence(entry.id, ordinal);
+    day->second.erase(index);
+    remove_if_empty(day);
+
+    // set new date to the event and add it to the moved date
+    set_event_date(entry.id, new_date);
+    day_events(day_ordinal(new_date)).insert(entry);
+
+    if (occurrence)
+    {
+        // the moved occurrence is a normal event from now on
+        const Event& event = pool_.get(entry.id);
+        log_add(day_ordinal(new_date), event.start(), event.end(), event.name(),
+                event.description());
+        return;
+    }
+
+    JournalRecord record{JournalRecordType::MOVE};
+    record.ordinal = ordinal;
+    record.index = position;
+    record.new_ordinal = day_ordinal(new_date);
+    log(record);
+}
+
+
+/* Makes the change of a history entry through the same functions as
+ * the user would, so the journal, search index and reminders follow.
+ * A deleted event comes back with its handle and takes a binary
+ * searched place in its day, the day is not sorted again.
+ */
+bool Calendar::apply(const HistoryEntry& entry, HistoryEntry& inverse)
+{
+    inverse = entry;
+    map<int, DayEvents>::iterator day;
+    int index = 0;
+    switch (entry.action)
+    {
+    case HistoryAction::REMOVE:
+        if (!locate(entry.id, day, index))
+            return false;
+        delete_at(day, index);
+        inverse.action = HistoryAction::RESTORE;
+        return true;
+
+    case HistoryAction::RESTORE:
+    {
+        if (!pool_.restore(entry.id))
+            return false;
+        const Event& event = pool_.get(entry.id);
+        int ordinal = day_ordinal(event.date());
+        if (search_index_built_)
+            search_index_.add(entry.id, event);
+        update_reminder(entry.id);
+        day_events(ordinal).insert({event.start(), event.end(), entry.id});
+        log_add(ordinal, event.start(), event.end(), event.name(), event.description());
+        inverse.action = HistoryAction::REMOVE;
+        return true;
+    }
+
+    case HistoryAction::MOVE_TO:
+        if (!locate(entry.id, day, index))
+            return false;
+        inverse.ordinal = day->first;
+        if (day->first != entry.ordinal)
+            move_at(day, index, date_from_ordinal(entry.ordinal));
+        return true;
+    }
+    return false;
+}
+
+/* The entries of a group are undone in the opposite order they were
+ * made. The inverses are returned in the order they were applied.
+ */
+vector<HistoryEntry> Calendar::apply_group(const vector<HistoryEntry>& group)
+{
+    vector<HistoryEntry> inverses;
+    inverses.reserve(group.size());
+    for (vector<HistoryEntry>::const_reverse_iterator iter = group.rbegin();
+         iter != group.rend(); ++iter)
+    {
+        HistoryEntry inverse;
+        // events dropped since (e.g. by loading a snapshot) are skipped
+        if (apply(*iter, inverse))
+            inverses.push_back(inverse);
+    }
+    return inverses;
+}
+
+bool Calendar::undo()
+{
+    vector<HistoryEntry> group = history_.take_undo();
+    if (group.empty())
+        return false;
+
+    history_.push_redo(apply_group(group));
+    return true;
+}
+
+bool Calendar::redo()
+{
+    vector<HistoryEntry> group = history_.take_redo();
+    if (group.empty())
+        return false;
+
+    history_.push_undo(apply_group(group));
+    return true;
+}
+
+void Calendar::set_history_budget(size_t bytes)
+{
+    history_.set_budget(bytes);
+}
+
+
+/* Returns the events of the date that overlap the range [start, end). */
+vector<EventId> Calendar::overlapping(Date date, Time::Minutes start,
+                                       Time::Minutes end)
+{
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(date));
+    if (iter == events_.end())
+        return {};
+
+    return iter->second.overlapping(start, end);
+}
+
+/* Checks if some event of the date overlaps the range [start, end). */
+bool Calendar::has_conflict(Date date, Time::Minutes start, Time::Minutes end)
+{
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(date));
+    if (iter == events_.end())
+        return false;
+
+    return iter->second.has_conflict(start, end);
+}
+
+/* Finds the first free time of the given length between the dates.
+ * Days without any events are free for the whole day.
+ */
+bool Calendar::find_free_slot(Time::Minutes duration, Date from_date, Date to_date,
+                              Date& slot_date, Time::Minutes& slot_start)
+{
+    if (duration > DAY_END)
+        return false;
+
+    int last = day_ordinal(to_date);
+    drop_expanded_days(day_ordinal(from_date), last);
+    load_days(day_ordinal(from_date), last);
+    map<int, DayEvents>::iterator iter = events_.lower_bound(day_ordinal(from_date));
+    for (int current = day_ordinal(from_date); current <= last; ++current)
+    {
+        // a day without events is free for the whole day
+        if (iter == events_.end() || current < iter->first)
+        {
+            slot_date = date_from_ordinal(current);
+            slot_start = 0;
+            return true;
+        }
+
+        if (iter->second.find_free_slot(duration, slot_start))
+        {
+            slot_date = date_from_ordinal(current);
+            return true;
+        }
+        ++iter;
+    }
+    return false;
+}
+
+/* Returns a view over all events from the first date to the last date. */
+EventRange Calendar::events_in_range(Date from, Date to)
+{
+    drop_expanded_days(day_ordinal(from), day_ordinal(to));
+    load_days(day_ordinal(from), day_ordinal(to));
+    return EventRange(events_.lower_bound(day_ordinal(from)),
+                      events_.upper_bound(day_ordinal(to)), &pool_);
+}
+
+
+/* Loads all days still in a snapshot and the occurrences of series
+ * between the first and the last day.
+ */
+EventRange Calendar::all_events()
+{
+    if (events_.empty() && cold_days_.empty())
+        return EventRange(events_.end(), events_.end(), &pool_);
+
+    int first = numeric_limits<int>::max();
+    int last = numeric_limits<int>::min();
+    if (!events_.empty())
+    {
+        first = events_.begin()->first;
+        last = events_.rbegin()->first;
+    }
+    if (!cold_days_.empty())
+    {
+        first = min(first, cold_days_.begin()->first);
+        last = max(last, cold_days_.rbegin()->first);
+    }
+    drop_expanded_days(first, last);
+    load_days(first, last);
+    return EventRange(events_.begin(), events_.end(), &pool_);
+}
+
+bool Calendar::has_unloaded_days() const
+{
+    return !cold_days_.empty() || !series_.empty();
+}
+
+int Calendar::loaded_events_count(Date date) const
+{
+    map<int, DayEvents>::const_iterator iter = events_.find(day_ordinal(date));
+    return iter == events_.end() ? 0 : iter->second.size();
+}
+
+EventRange Calendar::loaded_events_in_range(Date from, Date to) const
+{
+    return EventRange(events_.lower_bound(day_ordinal(from)),
+                      events_.upper_bound(day_ordinal(to)), &pool_);
+}
+
+int Calendar::export_events(streambuf& sink, ExportFormat format, Date from, Date to)
+{
+    EventExporter exporter(sink, format);
+    int written = exporter.write_range(events_in_range(from, to));
+    return exporter.good() ? written : -1;
+}
+
+int Calendar::export_events(streambuf& sink, ExportFormat format)
+{
+    EventExporter exporter(sink, format);
+    int written = exporter.write_range(all_events());
+    return exporter.good() ? written : -1;
+}
+
+/* The texts of the cold days are read from the snapshot without
+ * creating their events. Each distinct text is split only once.
+ */
+void Calendar::index_cold_days()
+{
+    unordered_map<string_view, vector<string>> text_words;
+    for (const pair<const int, ColdDay>& cold : cold_days_)
+    {
+        vector<string> words;
+        for (const SnapshotEvent& event : cold.second.reader->read_day(cold.second.index))
+        {
+            for (string_view text : {event.name, event.description})
+            {
+                unordered_map<string_view, vector<string>>::iterator iter =
+                    text_words.find(text);
+                if (iter == text_words.end())
+                    iter = text_words.insert({text, split_words(text)}).first;
+                words.insert(words.end(), iter->second.begin(), iter->second.end());
+            }
+        }
+        search_index_.add_unloaded_day(cold.first, words);
+    }
+}
+
+/* Only the days that may have matches are loaded: the cold days that
+ * have every word and the occurrences of the series that match. The
+ * index is built on the first search and kept up to date after that,
+ * so adding events costs nothing extra before anyone searches.
+ */
+vector<EventId> Calendar::search(const string& query, Date from, Date to)
+{
+    int first = day_ordinal(from);
+    int last = day_ordinal(to);
+    drop_expanded_days(first, last);
+    if (!search_index_built_)
+    {
+        for (const pair<const int, DayEvents>& day : events_)
+        {
+            for (const DayEntry& entry : day.second)
+                search_index_.add(entry.id, pool_.get(entry.id));
+        }
+        index_cold_days();
+        search_index_built_ = true;
+    }
+
+    for (int ordinal : search_index_.unloaded_days(query, first, last))
+    {
+        if (cold_days_.count(ordinal) != 0)
+            load_day(ordinal);
+    }
+    for (const Recurrence& series : series_)
+    {
+        if (!SearchIndex::text_matches(query, series.name(), series.description()))
+            continue;
+        for (int ordinal : series.occurrences(first, last))
+            load_day(ordinal);
+    }
+    return search_index_.search(query, first, last);
+}
+
+/* An event has a reminder while it is due after the reminders
+ * already given.
+ */
+void Calendar::update_reminder(EventId id)
+{
+    if (!reminders_started_)
+        return;
+
+    const Event& event = pool_.get(id);
+    Instant due = to_instant(day_ordinal(event.date()), event.start()) - reminder_lead_time_;
+    if (due > reminded_until_)
+        reminders_.set(id, due);
+    else
+        reminders_.remove(id);
+}
+
+/* Creating the events of a day adds their reminders, so the days
+ * are loaded a few at a time as the time goes on.
+ */
+void Calendar::load_reminder_days(Instant now)
+{
+    if (!reminders_started_)
+        start_reminders(now);
+
+    int last = (int)((now + reminder_lead_time_) / (24 * 60)) + REMINDER_DAYS_AHEAD;
+    if (last <= reminder_days_loaded_)
+        return;
+
+    load_days(reminder_days_loaded_ + 1, last);
+    reminder_days_loaded_ = last;
+}
+
+/* Adds the reminders of the loaded events that are due after now. */
+void Calendar::start_reminders(Instant now, Time::Minutes lead_time)
+{
+    reminders_.clear();
+    reminders_started_ = true;
+    reminder_lead_time_ = lead_time;
+    reminded_until_ = now;
+
+    // an event of a later day can be due today because of the lead time
+    int today = (int)(now / (24 * 60));
+    for (map<int, DayEvents>::iterator day = events_.lower_bound(today);
+         day != events_.end(); ++day)
+    {
+        for (const DayEntry& entry : day->second)
+            update_reminder(entry.id);
+    }
+    reminder_days_loaded_ = today - 1;
+    load_reminder_days(now);
+}
+
+/* Events of the days after the loaded ones are due only after
+ * the first minute of those days (minus the lead time).
+ */
+bool Calendar::next_due(Instant now, Reminder& reminder)
+{
+    load_reminder_days(now);
+    if (!reminders_.top(reminder))
+        return false;
+    return reminder.due < to_instant(reminder_days_loaded_ + 1, 0) - reminder_lead_time_;
+}
+
+vector<Reminder> Calendar::pop_due(Instant now)
+{
+    load_reminder_days(now);
+    vector<Reminder> due;
+    Reminder reminder;
+    while (reminders_.top(reminder) && reminder.due <= now)
+    {
+        due.push_back(reminder);
+        reminders_.pop();
+    }
+    reminded_until_ = max(reminded_until_, now);
+    return due;
+}
+
+/* Returns the days of the month that have events as bits. */
+uint32_t Calendar::month_summary(int month, int year) const
+{
+    uint32_t days = 0;
+    map<int, uint32_t>::const_iterator iter = month_summaries_.find(month_key(month, year));
+    if (iter != month_summaries_.end())
+        days = iter->second;
+
+    // occurrences of series that are not expanded yet
+    int first = day_ordinal(1, month, year);
+    int last = first + Date::days_in_month(month, year) - 1;
+    for (size_t series = 0; series < series_.size(); ++series)
+    {
+        for (int ordinal : series_.at(series).occurrences(first, last))
+        {
+            map<int, size_t>::const_iterator expanded = expanded_series_.find(ordinal);
+            if (expanded == expanded_series_.end() || expanded->second <= series)
+                days |= 1u << (ordinal - first);
+        }
+    }
+    return days;
+}
+
+
+/* Moves the old days out of events_ to a segment and makes them cold
+ * days of it, so they are loaded like the days of a snapshot.
+ */
+int Calendar::archive_before(Date cutoff, const string& file_name)
+{
+    map<int, DayEvents>::iterator first_kept = events_.lower_bound(day_ordinal(cutoff));
+    map<int, DayEvents> archived;
+    while (events_.begin() != first_kept)
+    {
+        archived.insert(events_.extract(events_.begin()));
+    }
+    if (archived.empty())
+        return 0;
+
+    // occurrences are not written, they are created again from their series
+    shared_ptr<SnapshotReader> reader = make_shared<SnapshotReader>();
+    if (!write_snapshot(file_name, archived, pool_, epoch_, {},
+                        [this](EventId id) { return occurrences_.count(id) == 0; }) ||
+        !reader->open(file_name))
+    {
+        events_.merge(archived);
+        return -1;
+    }
+
+    // month summaries already have the days, except the ones that had only
+    // occurrences, month_summary() finds those from the series
+    for (const pair<const int, DayEvents>& day : archived)
+    {
+        if (stored_position(day.second, day.second.size()) == 1)
+            unmark_day(day.first);
+    }
+    expanded_series_.erase(expanded_series_.begin(),
+                           expanded_series_.lower_bound(day_ordinal(cutoff)));
+    for (int i = 0; i < reader->day_count(); ++i)
+    {
+        cold_days_.insert({reader->day_ordinal(i), ColdDay{reader, i}});
+    }
+    rebuild_pool();
+    // rebuilding emptied the index
+    if (search_index_built_)
+        index_cold_days();
+    return reader->day_count();
+}
+
+/* The events keep their days and order, so the journal stays valid.
+ * The search index and reminders are filled again with the new handles.
+ */
+void Calendar::rebuild_pool()
+{
+    // the dropped history reclaims slots of the old pool
+    history_.clear();
+    // the handles of the old pool are not valid in the new one
+    EventPool old_pool = std::move(pool_);
+    pool_ = EventPool(old_pool.next_generation());
+    unordered_map<EventId, int> old_occurrences = std::move(occurrences_);
+    occurrences_.clear();
+    search_index_.clear();
+    reminders_.clear();
+
+    for (pair<const int, DayEvents>& day : events_)
+    {
+        for (int i = 0; i < day.second.size(); ++i)
+        {
+            EventId old_id = day.second.at(i).id;
+            const Event& event = old_pool.get(old_id);
+            EventId id = create_event(event.date(), event.name(), event.start(),
+                                      event.end(), event.description());
+            unordered_map<EventId, int>::const_iterator occurrence =
+                old_occurrences.find(old_id);
+            if (occurrence != old_occurrences.end())
+                occurrences_.insert({id, occurrence->second});
+            day.second.set_id(i, id);
+        }
+    }
+}
+
+
+/* Writes every event, including not yet loaded ones, and the series
+ * to a snapshot. Occurrences are not written, the series is enough to
+ * create them again. The snapshot starts a new epoch and the journal
+ * is emptied.
+ */
+bool Calendar::save_snapshot(const string& file_name)
+{
+    for (const pair<const int, ColdDay>& cold : cold_days_)
+    {
+        materialise(cold.first, cold.second);
+    }
+    cold_days_.clear();
+
+    if (!write_snapshot(file_name, events_, pool_, epoch_ + 1, series_,
+                        [this](EventId id) { return occurrences_.count(id) == 0; }))
+        return false;
+    epoch_++;
+
+    // if the program stops before this, the journal is of the old
+    // epoch and will be skipped on the next start
+    if (journal_ != nullptr)
+    {
+        journal_->truncate();
+        JournalRecord record{JournalRecordType::EPOCH};
+        record.ordinal = epoch_;
+        journal_->append(record);
+        log_chosen_date();
+        journal_->sync();
+    }
+    return true;
+}
+
+/* Replaces the events with the days of the snapshot. Month summaries
+ * are filled right away so print_month works without loading any day.
+ */
+bool Calendar::load_snapshot(const string& file_name)
+{
+    shared_ptr<SnapshotReader> reader = make_shared<SnapshotReader>();
+    if (!reader->open(file_name))
+        return false;
+
+    events_.clear();
+    month_summaries_.clear();
+    cold_days_.clear();
+    series_.clear();
+    expanded_series_.clear();
+    expanded_limit_ = MAX_EXPANDED_DAYS;
+    occurrences_.clear();
+    search_index_.clear();
+    search_index_built_ = false;
+    reminders_.clear();
+    reminders_started_ = false;
+    history_.clear();
+    pool_ = EventPool(pool_.next_generation());
+    epoch_ = reader->epoch();
+    for (int i = 0; i < reader->day_count(); ++i)
+    {
+        int ordinal = reader->day_ordinal(i);
+        cold_days_.insert({ordinal, ColdDay{reader, i}});
+        mark_day(ordinal);
+    }
+    for (int i = 0; i < reader->series_count(); ++i)
+    {
+        series_.push_back(reader->read_series(i));
+    }
+    return true;
+}
+
+
+/* Records the change if a journal is open. */
+void Calendar::log(const JournalRecord& record)
+{
+    if (journal_ != nullptr)
+        journal_->append(record);
+}
+
+void Calendar::log_add(int ordinal, Time::Minutes start, Time::Minutes end,
+                       const string& name, const string& description)
+{
+    if (journal_ == nullptr)
+        return;
+
+    JournalRecord record{JournalRecordType::ADD};
+    record.ordinal = ordinal;
+    record.start = start;
+    record.end = end;
+    record.name = name;
+    record.description = description;
+    journal_->append(record);
+}
+
+void Calendar::log_chosen_date()
+{
+    JournalRecord record{JournalRecordType::CHANGE_DATE};
+    record.ordinal = day_ordinal(chosen_date_);
+    log(record);
+}
+
+/* Replays the journal and starts recording changes to it.
+ * Consecutive added events are collected and added as one batch,
+ * so replaying does not sort a day once per added event.
+ */
+bool Calendar::open_journal(const string& file_name, int group_size, int max_delay_ms)
+{
+    // no journal while replaying, the changes are already recorded
+    journal_.reset();
+
+    bool stale = false;
+    bool has_epoch = false;
+    vector<EventData> batch;
+    auto add_batch = [this, &batch]()
+    {
+        if (!batch.empty())
+            add_events(std::move(batch));
+        batch.clear();
+    };
+
+    int records = Journal::replay(file_name, [&](const JournalRecord& record)
+    {
+        if (record.type == JournalRecordType::EPOCH)
+        {
+            has_epoch = true;
+            stale = record.ordinal != (int)epoch_;
+            return;
+        }
+        if (stale)
+            return;
+
+        if (record.type == JournalRecordType::ADD)
+        {
+            batch.push_back({date_from_ordinal(record.ordinal), record.name,
+                             record.start, record.end, record.description});
+            return;
+        }
+        if (record.type == JournalRecordType::CHANGE_DATE)
+        {
+            chosen_date_ = date_from_ordinal(record.ordinal);
+            return;
+        }
+
+        // other changes refer to the order of events, add pending ones first
+        add_batch();
+        if (record.type == JournalRecordType::SERIES)
+        {
+            add_recurring_event(record.name, record.start, record.end, record.description,
+                                date_from_ordinal(record.ordinal), record.rule);
+            return;
+        }
+        if (record.type == JournalRecordType::EXCEPTION)
+        {
+            add_recurrence_exception(record.index, date_from_ordinal(record.ordinal));
+            return;
+        }
+
+        // the index counts the events that are not occurrences of a series
+        map<int, DayEvents>::iterator day = find_day(record.ordinal);
+        int index = day == events_.end() ? -1 : day_index(day->second, record.index);
+        if (index < 0)
+            return;
+        if (record.type == JournalRecordType::DELETE)
+        {
+            // replayed changes are not undone, so the slot is reused right away
+            EventId id = day->second.at(index).id;
+            delete_at(day, index);
+            reclaim_event(id);
+        }
+        else if (record.type == JournalRecordType::MOVE)
+            move_at(day, index, date_from_ordinal(record.new_ordinal));
+    });
+    add_batch();
+    // replayed changes are not undone
+    history_.clear();
+
+    unique_ptr<Journal> journal = make_unique<Journal>(group_size, max_delay_ms);
+    if (!journal->open(file_name))
+        return false;
+    journal_ = std::move(journal);
+
+    // start a new journal for the current epoch
+    if (records <= 0 || stale || !has_epoch)
+    {
+        journal_->truncate();
+        JournalRecord record{JournalRecordType::EPOCH};
+        record.ordinal = epoch_;
+        journal_->append(record);
+        log_chosen_date();
+    }
+    return journal_->sync();
+}
+
+bool Calendar::sync_journal()
+{
+    return journal_ != nullptr && journal_->sync();
+}
+
+
+/* A handle of a deleted event does not reach the event that now
+ * has its slot, as the generation of the slot has changed.
+ */
+const Event& Calendar::event(EventId id) const
+{
+    static const string no_text;
+    static const Event no_event(Date(), &no_text, 0, 0, &no_text);
+
+    const Event* found = find_event(id);
+    return found != nullptr ? *found : no_event;
+}
+
+const Event* Calendar::find_event(EventId id) const
+{
+    return pool_.contains(id) ? &pool_.get(id) : nullptr;
+}
+
+size_t MemoryUsage::total_bytes() const
+{
+    return event_bytes + index_bytes + string_bytes;
+}
+
+double MemoryUsage::bytes_per_event() const
+{
+    if (events == 0)
+        return 0;
+    return (double)total_bytes() / events;
+}
+
+/* Estimates the memory used by loaded events, their day entries and texts. */
+MemoryUsage Calendar::memory_usage() const
+{
+    MemoryUsage usage;
+    usage.events = pool_.size();
+    usage.event_bytes = pool_.event_bytes();
+    usage.string_bytes = pool_.strings().bytes();
+
+    // a map node holds the key, DayEvents and three pointers and a color
+    const size_t node_overhead = 4 * sizeof(void*);
+    for (const pair<const int, DayEvents>& day : events_)
+    {
+        usage.index_bytes += sizeof(day) + node_overhead + day.second.bytes();
+    }
+    return usage;
+}
+
+
+/* Getter for the currently chosen date. */
+Date Calendar::chosen_date()
+{
+    return chosen_date_;
+}
+/* Getter for the events count. */
+
+int Calendar::events_count(Date date)
+{
+    map<int, DayEvents>::iterator iter = find_day(day_ordinal(date));
+    // no events in the day
+    if (iter == events_.end() || iter->second.empty()) {
+        return 0;
+    }
+
+    const DayEvents& events_today = iter->second;
+    return events_today.size();
+}
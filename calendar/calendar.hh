@@ -0,0 +1,517 @@
+/*
+ * Class Calendar
+ * ----------
+ * Stores events by date and keeps track of the currently
+ * chosen date. All commands of the calendar program operate
+ * through this class.
+ */
+
+#ifndef CALENDAR_HH
+#define CALENDAR_HH
+
+#include "date.hh"
+#include "time.hh"
+#include "event.hh"
+#include "dayevents.hh"
+#include "eventrange.hh"
+#include "eventpool.hh"
+#include "snapshot.hh"
+#include "journal.hh"
+#include "recurrence.hh"
+#include "searchindex.hh"
+#include "eventexporter.hh"
+#include "reminderqueue.hh"
+#include "history.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// memory used by the events of a calendar
+struct MemoryUsage
+{
+    int events = 0;
+    // event slots of the pool
+    std::size_t event_bytes = 0;
+    // day entries and the map of days
+    std::size_t index_bytes = 0;
+    // interned names and descriptions
+    std::size_t string_bytes = 0;
+
+    std::size_t total_bytes() const;
+    double bytes_per_event() const;
+};
+
+// how many days ahead reminders look for events that are not loaded yet
+const int REMINDER_DAYS_AHEAD = 7;
+
+class Calendar
+{
+public:
+    Calendar();
+
+    // the history refers to the calendar, so it is not copied or moved
+    Calendar(const Calendar&) = delete;
+    Calendar& operator=(const Calendar&) = delete;
+
+    /**
+     * @brief add_event constructs and adds an event for the chosen date
+     * @return false if times are invalid or start >= end
+     */
+    bool add_event(std::string name, Time::Minutes start, Time::Minutes end,
+                   std::string description);
+
+    /**
+     * @brief add_event constructs and adds an event for the given date
+     * @return false if times are invalid or start >= end
+     */
+    bool add_event(std::string name, Time::Minutes start, Time::Minutes end,
+                   std::string description, Date date_for_event);
+
+    /**
+     * @brief add_events adds many events at once. Each event is added to
+     * its own date and every affected day is sorted only once.
+     * Events with invalid times are skipped.
+     * @param events events to be added
+     * @return amount of events added
+     */
+    int add_events(std::vector<EventData> events);
+
+    /**
+     * @brief add_recurring_event adds a repeating event. The series is
+     * stored once (also in the journal and snapshots) and the events of
+     * its occurrences are created only when their date is used (printed,
+     * counted, queried or changed). A deleted or moved occurrence becomes
+     * an exception of the series. Days that only have occurrences are
+     * dropped again by a later range query once many days have been
+     * expanded, and their events get new handles when they are used again.
+     * @param first_date date of the first occurrence
+     * @param rule how the event repeats
+     * @return id of the series, -1 if times are invalid
+     */
+    int add_recurring_event(std::string name, Time::Minutes start,
+                            Time::Minutes end, std::string description,
+                            Date first_date, RecurrenceRule rule);
+
+    /**
+     * @brief add_recurrence_exception leaves one occurrence of a series out.
+     * If the occurrence is already an event, the event is deleted.
+     * @param series id returned by add_recurring_event
+     * @param date date of the occurrence
+     * @return false if the series does not exist
+     */
+    bool add_recurrence_exception(int series, Date date);
+
+    void change_date(Date new_date);
+    bool change_month(int month);
+    bool change_day(int day);
+
+    void print_month();
+    void print_day();
+    bool print_event(int i);
+
+    bool delete_event(int i);
+    bool move_event(int i, Date new_date);
+
+    /**
+     * @brief event_id gives the handle of the i:th event of the chosen date.
+     * Handles stay the same when events are added, moved or deleted.
+     * @param i 1-based index of the event
+     * @param id set to the handle if found
+     * @return false if there is no such event
+     */
+    bool event_id(int i, EventId& id);
+
+    /**
+     * @brief delete_by_id deletes an event without going through its day
+     * @param id handle of the event
+     * @return false if the event does not exist
+     */
+    bool delete_by_id(EventId id);
+
+    /**
+     * @brief move_by_id moves an event to a new date. Only its small
+     * day entry is moved, the event itself is not copied.
+     * @param id handle of the event
+     * @return false if the event does not exist or the date is invalid
+     */
+    bool move_by_id(EventId id, Date new_date);
+
+    /**
+     * @brief delete_events deletes many events with one pass over each day
+     * @param ids handles of the events, unknown handles are skipped
+     * @return amount of events deleted
+     */
+    int delete_events(const std::vector<EventId>& ids);
+
+    /**
+     * @brief move_events moves many events to a new date. Each day is gone
+     * through once and the new date is sorted once. Events that are already
+     * on the new date are not moved.
+     * @param ids handles of the events, unknown handles are skipped
+     * @return amount of events moved
+     */
+    int move_events(const std::vector<EventId>& ids, Date new_date);
+
+    /**
+     * @brief undo reverts the latest change (add, delete or move of
+     * events). A batch change is reverted as a whole.
+     * @return false if there is nothing to undo
+     */
+    bool undo();
+
+    /**
+     * @brief redo makes the latest undone change again. Any new change
+     * after an undo makes the undone changes impossible to redo.
+     * @return false if there is nothing to redo
+     */
+    bool redo();
+
+    /**
+     * @brief set_history_budget limits the memory used by undo and redo,
+     * the oldest changes are forgotten first. The budget covers the
+     * history entries. A delete that can be undone also keeps the slot
+     * of its event, the slot is reused once the delete is forgotten.
+     * @param bytes most memory the history may use
+     */
+    void set_history_budget(std::size_t bytes);
+
+    /**
+     * @brief overlapping finds the events of a date that overlap a time range
+     * @param date the date to look at
+     * @param start beginning of the range
+     * @param end end of the range (exclusive)
+     * @return handles of overlapping events ordered by time
+     */
+    std::vector<EventId> overlapping(Date date, Time::Minutes start,
+                                      Time::Minutes end);
+
+    /**
+     * @brief has_conflict checks if a time range of a date is already taken
+     * @return true if some event overlaps the range
+     */
+    bool has_conflict(Date date, Time::Minutes start, Time::Minutes end);
+
+    /**
+     * @brief find_free_slot finds the first free time of the given length
+     * between from_date and to_date (both included)
+     * @param slot_date set to the date of the free time if found
+     * @param slot_start set to the start of the free time if found
+     * @return true if a free slot was found
+     */
+    bool find_free_slot(Time::Minutes duration, Date from_date, Date to_date,
+                        Date& slot_date, Time::Minutes& slot_start);
+
+    /**
+     * @brief events_in_range gives all events between two dates
+     * @param from first date of the range
+     * @param to last date of the range (included)
+     * @return a view over the events ordered by date and time, valid
+     * until the calendar is changed or another range is queried
+     */
+    EventRange events_in_range(Date from, Date to);
+
+    /**
+     * @brief all_events gives every event of the calendar. Repeating events
+     * are included between the first and last date that has events.
+     * @return a view over the events ordered by date and time
+     */
+    EventRange all_events();
+
+    /**
+     * @brief has_unloaded_days
+     * @return true if some events are still only in a snapshot or a
+     * series, so the queries above have to create them first
+     */
+    bool has_unloaded_days() const;
+
+    /**
+     * @brief loaded_events_count counts the events of a date without
+     * loading it. Nothing is changed, so many threads may call this at
+     * once. Every event is counted only if has_unloaded_days() is false.
+     */
+    int loaded_events_count(Date date) const;
+
+    /**
+     * @brief loaded_events_in_range gives the events between two dates
+     * without loading them, like loaded_events_count()
+     * @return a view over the events ordered by date and time
+     */
+    EventRange loaded_events_in_range(Date from, Date to) const;
+
+    /**
+     * @brief export_events writes the events between two dates to a sink
+     * @param sink where the events are written, e.g. a BufferedWriter
+     * @param format JSON Lines or CSV
+     * @param from first date of the range
+     * @param to last date of the range (included)
+     * @return amount of events written, -1 if the sink failed
+     */
+    int export_events(std::streambuf& sink, ExportFormat format, Date from, Date to);
+
+    /**
+     * @brief export_events writes every event of the calendar to a sink
+     * @return amount of events written, -1 if the sink failed
+     */
+    int export_events(std::streambuf& sink, ExportFormat format);
+
+    /**
+     * @brief search finds the events whose name or description has every
+     * word of the query, case-insensitively. A word ending with '*' is a
+     * prefix, e.g. "audit rev*" matches "Review of the audit". Only the
+     * days that may have matches are loaded.
+     * @param query the words to look for
+     * @param from first date of the range
+     * @param to last date of the range (included)
+     * @return handles of the matching events ordered by date
+     */
+    std::vector<EventId> search(const std::string& query, Date from, Date to);
+
+    /**
+     * @brief start_reminders starts keeping reminders of the events
+     * that are due after now. From then on reminders follow added,
+     * deleted and moved events.
+     * @param now the current instant
+     * @param lead_time how many minutes before its start an event is due
+     */
+    void start_reminders(Instant now, Time::Minutes lead_time = 0);
+
+    /**
+     * @brief next_due gives the reminder that is due next. Days that are
+     * not loaded yet (in a snapshot or a series) are looked at only
+     * REMINDER_DAYS_AHEAD days ahead of now.
+     * @param now the current instant, reminders start here if not started
+     * @param reminder set to the next reminder if found
+     * @return false if no reminder is due in the days looked at
+     */
+    bool next_due(Instant now, Reminder& reminder);
+
+    /**
+     * @brief pop_due removes the reminders that are due at or before now
+     * @param now the current instant, reminders start here if not started
+     * @return the reminders ordered by when they were due
+     */
+    std::vector<Reminder> pop_due(Instant now);
+
+    /**
+     * @brief month_summary tells which days of a month have events
+     * @return bit (day - 1) is set if the day has at least one event
+     */
+    std::uint32_t month_summary(int month, int year) const;
+
+    /**
+     * @brief save_snapshot writes all events and series to a binary snapshot file.
+     * If a journal is open, this is also its compaction step: the journal
+     * is emptied as all of its changes are now in the snapshot.
+     * @param file_name path of the snapshot
+     * @return false if the file could not be written
+     */
+    bool save_snapshot(const std::string& file_name);
+
+    /**
+     * @brief load_snapshot replaces all events with the ones in the
+     * snapshot. Only the day index is read here, the events of a day
+     * are created when the day is first used.
+     * @param file_name path of the snapshot
+     * @return false if the snapshot could not be opened
+     */
+    bool load_snapshot(const std::string& file_name);
+
+    /**
+     * @brief archive_before moves the days before the cutoff to a segment
+     * file (in the snapshot format). Only their month summaries stay in
+     * memory, and a day is read back when it is used again, e.g. by
+     * print_day or a range query. The event pool is rebuilt to free the
+     * memory, so handles given before this are not valid after it.
+     * @param cutoff days before this date are archived
+     * @param file_name path of the segment, each archive needs its own file
+     * @return amount of days archived, -1 if the segment could not be written
+     */
+    int archive_before(Date cutoff, const std::string& file_name);
+
+    /**
+     * @brief open_journal replays the changes recorded in the journal
+     * and then starts recording every change to it. Load the snapshot
+     * first, replay is skipped if the snapshot already has the changes.
+     * @param file_name path of the journal
+     * @param group_size amount of changes synced to disk together
+     * @param max_delay_ms longest time a change waits for its group
+     * before it is synced, 0 for no time limit
+     * @return false if the journal could not be opened
+     */
+    bool open_journal(const std::string& file_name, int group_size = 64,
+                      int max_delay_ms = 10);
+
+    /**
+     * @brief sync_journal writes recorded changes to disk right away
+     * @return false if writing failed or no journal is open
+     */
+    bool sync_journal();
+
+    /**
+     * @brief event gives the event of a handle
+     * @param id handle returned by a query or an EventRange iterator
+     * @return the event, valid until the event is deleted. A handle of a
+     * deleted event gives an event without a name, date or times.
+     */
+    const Event& event(EventId id) const;
+
+    /**
+     * @brief find_event gives the event of a handle if it still exists
+     * @param id handle returned by a query or an EventRange iterator
+     * @return the event, nullptr if the event has been deleted
+     */
+    const Event* find_event(EventId id) const;
+
+    /**
+     * @brief memory_usage
+     * @return estimate of the memory used by the loaded events
+     */
+    MemoryUsage memory_usage() const;
+
+    Date chosen_date();
+    int events_count(Date date);
+
+private:
+    // currently chosen date
+    Date chosen_date_;
+
+    // owns every loaded event and their texts
+    EventPool pool_;
+
+    // events of each date ordered by time, keyed by the day ordinal
+    // of the date (see dayordinal.hh) so range scans are cheap
+    std::map<int, DayEvents> events_;
+
+    // words of the loaded events and of the cold days, built on the
+    // first search
+    SearchIndex search_index_;
+    bool search_index_built_ = false;
+
+    // pending reminders, only kept after start_reminders()
+    ReminderQueue reminders_;
+    bool reminders_started_ = false;
+    Time::Minutes reminder_lead_time_ = 0;
+    // reminders due at or before this have been given already
+    Instant reminded_until_ = 0;
+    // last day whose events are surely in reminders_
+    int reminder_days_loaded_ = 0;
+
+    // inverses of the latest changes for undo and redo
+    History history_;
+
+    // days with events of each month, keyed by year * 12 + month - 1
+    std::map<int, std::uint32_t> month_summaries_;
+
+    struct ColdDay
+    {
+        std::shared_ptr<SnapshotReader> reader;
+        int index;
+    };
+    // days stored in a snapshot whose events have not been created yet
+    std::map<int, ColdDay> cold_days_;
+
+    // journal where changes are recorded, nullptr if not used
+    std::unique_ptr<Journal> journal_;
+    // epoch of the latest snapshot loaded or written
+    std::uint32_t epoch_ = 0;
+
+    // repeating events, the index is the series id
+    std::vector<Recurrence> series_;
+    // amount of series already expanded to events on each day that
+    // has been used, also days where no series occurred
+    std::map<int, std::size_t> expanded_series_;
+    // size of expanded_series_ at which drop_expanded_days() drops days
+    std::size_t expanded_limit_;
+    // events created from a series and the id of their series. They are
+    // not recorded to the journal or snapshots, their series is.
+    std::unordered_map<EventId, int> occurrences_;
+
+    // creates events for the occurrences of series not yet expanded on the day
+    void expand_day(int ordinal);
+    // expands every day between the ordinals that has occurrences
+    void expand_days(int first, int last);
+    // drops the days outside the ordinals that only have occurrences,
+    // if too many days have been expanded
+    void drop_expanded_days(int first, int last);
+    // makes an exception of an occurrence that is deleted or moved and
+    // records it, returns false if the event is not an occurrence
+    bool leave_out_occurrence(EventId id, int ordinal);
+    // 1-based position of the event at the 0-based index among the
+    // events of the day that are not occurrences, used by the journal
+    int stored_position(const DayEvents& day, int index) const;
+    // 0-based index of the event at the stored position, -1 if none
+    int day_index(const DayEvents& day, int position) const;
+
+    // records a change if a journal is open
+    void log(const JournalRecord& record);
+    // records an added event
+    void log_add(int ordinal, Time::Minutes start, Time::Minutes end,
+                 const std::string& name, const std::string& description);
+    // records a change of the chosen date
+    void log_chosen_date();
+
+    // creates the events of a day that are still in a snapshot
+    // or in a not yet expanded series
+    void load_day(int ordinal);
+    // creates the events of a cold day to the pool and events_
+    void materialise(int ordinal, const ColdDay& cold);
+    // loads all days between the ordinals
+    void load_days(int first, int last);
+    // finds a day from events_ after loading it
+    std::map<int, DayEvents>::iterator find_day(int ordinal);
+    // marks a day as having events in its month summary
+    void mark_day(int ordinal);
+    // marks a day as having no events in its month summary
+    void unmark_day(int ordinal);
+    // creates the loaded events to a new pool, which frees the
+    // slots of released events
+    void rebuild_pool();
+
+    // creates an event to the pool and adds it to the search index
+    EventId create_event(Date date, std::string_view name, Time::Minutes start,
+                         Time::Minutes end, std::string_view description);
+    // removes an event from the search index and the pool
+    void release_event(EventId id);
+    // frees the slot and the texts of a released event
+    void reclaim_event(EventId id);
+    // changes the date of an event in the pool and the search index
+    void set_event_date(EventId id, Date new_date);
+
+    // adds the days still in a snapshot to the search index by their words
+    void index_cold_days();
+
+    // sets or removes the reminder of an event after it has changed
+    void update_reminder(EventId id);
+    // loads the days up to REMINDER_DAYS_AHEAD days after now
+    void load_reminder_days(Instant now);
+
+    // finds the day and index of an event, false if it does not exist
+    bool locate(EventId id, std::map<int, DayEvents>::iterator& day, int& index);
+    // groups the handles of existing events by the ordinal of their day
+    std::map<int, std::unordered_set<EventId>> group_by_day(
+        const std::vector<EventId>& ids) const;
+    // deletes the event at the 0-based index of the day and records it
+    void delete_at(std::map<int, DayEvents>::iterator day, int index);
+    // moves the event at the 0-based index of the day and records it
+    void move_at(std::map<int, DayEvents>::iterator day, int index, Date new_date);
+
+    // makes one change of the history, returns false if its event is gone
+    bool apply(const HistoryEntry& entry, HistoryEntry& inverse);
+    // applies a group in reverse order and returns the inverses
+    std::vector<HistoryEntry> apply_group(const std::vector<HistoryEntry>& group);
+
+    // gives the events of a day, creating the day if needed
+    DayEvents& day_events(int ordinal);
+    // removes a day from events_ if it has no events left
+    void remove_if_empty(std::map<int, DayEvents>::iterator day);
+};
+
+#endif // CALENDAR_HH
@@ -0,0 +1,145 @@
+#include "calendarclient.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+// size of a single read from the socket
+const size_t READ_CHUNK = 64 * 1024;
+}
+
+CalendarClient::CalendarClient()
+{
+}
+
+CalendarClient::~CalendarClient()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool CalendarClient::connect(const string& socket_path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+        return false;
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = fd;
+    return true;
+}
+
+FrameBuilder CalendarClient::start_request(Command command, string_view calendar, Date date)
+{
+    FrameBuilder request(output_, next_request_++, (uint8_t)command);
+    request.add_text(calendar).add_date(date);
+    pending_++;
+    return request;
+}
+
+uint32_t CalendarClient::request_add(string_view calendar, Date date,
+                                     Time::Minutes start, Time::Minutes end,
+                                     string_view name, string_view description)
+{
+    start_request(Command::ADD, calendar, date)
+        .add_i32(start).add_i32(end).add_text(name).add_text(description).finish();
+    return next_request_ - 1;
+}
+
+uint32_t CalendarClient::request_delete(string_view calendar, Date date, int i)
+{
+    start_request(Command::DELETE, calendar, date).add_u32(i).finish();
+    return next_request_ - 1;
+}
+
+uint32_t CalendarClient::request_move(string_view calendar, Date date, int i, Date new_date)
+{
+    start_request(Command::MOVE, calendar, date).add_u32(i).add_date(new_date).finish();
+    return next_request_ - 1;
+}
+
+uint32_t CalendarClient::request_count(string_view calendar, Date date)
+{
+    start_request(Command::COUNT, calendar, date).finish();
+    return next_request_ - 1;
+}
+
+uint32_t CalendarClient::request_day(string_view calendar, Date date)
+{
+    start_request(Command::DAY, calendar, date).finish();
+    return next_request_ - 1;
+}
+
+uint32_t CalendarClient::request_conflict(string_view calendar, Date date,
+                                          Time::Minutes start, Time::Minutes end)
+{
+    start_request(Command::CONFLICT, calendar, date).add_i32(start).add_i32(end).finish();
+    return next_request_ - 1;
+}
+
+bool CalendarClient::flush()
+{
+    size_t written = 0;
+    while (written < output_.size())
+    {
+        ssize_t result = ::send(fd_, output_.data() + written,
+                                output_.size() - written, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0)
+            return false;
+        written += result;
+    }
+    output_.clear();
+    return true;
+}
+
+bool CalendarClient::receive(Frame& response)
+{
+    while (true)
+    {
+        long size = parse_frame(string_view(input_).substr(consumed_), response);
+        if (size < 0)
+            return false;
+        if (size > 0)
+        {
+            consumed_ += size;
+            pending_--;
+            return true;
+        }
+
+        // the given out responses are no longer needed
+        input_.erase(0, consumed_);
+        consumed_ = 0;
+
+        size_t old_size = input_.size();
+        input_.resize(old_size + READ_CHUNK);
+        ssize_t result = ::read(fd_, &input_[old_size], READ_CHUNK);
+        input_.resize(old_size + max<ssize_t>(result, 0));
+        if (result == 0 || (result < 0 && errno != EINTR))
+            return false;
+    }
+}
+
+size_t CalendarClient::pending() const
+{
+    return pending_;
+}
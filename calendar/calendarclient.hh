@@ -0,0 +1,83 @@
+/*
+ * Class CalendarClient
+ * ----------
+ * Client of the calendar daemon (see calendarserver.hh). Requests
+ * are collected to a buffer and written together by flush(), so a
+ * client can have many requests on the way at once (pipelining).
+ * receive() blocks until the next response has arrived.
+ */
+
+#ifndef CALENDARCLIENT_HH
+#define CALENDARCLIENT_HH
+
+#include "protocol.hh"
+#include "time.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class CalendarClient
+{
+public:
+    CalendarClient();
+    ~CalendarClient();
+
+    CalendarClient(const CalendarClient&) = delete;
+    CalendarClient& operator=(const CalendarClient&) = delete;
+
+    /**
+     * @brief connect connects to the socket of a running server
+     * @return false if the server could not be reached
+     */
+    bool connect(const std::string& socket_path);
+
+    // The request functions add a request to the buffer and return
+    // its number, which the response of the request carries.
+    std::uint32_t request_add(std::string_view calendar, Date date,
+                              Time::Minutes start, Time::Minutes end,
+                              std::string_view name, std::string_view description);
+    std::uint32_t request_delete(std::string_view calendar, Date date, int i);
+    std::uint32_t request_move(std::string_view calendar, Date date, int i,
+                               Date new_date);
+    std::uint32_t request_count(std::string_view calendar, Date date);
+    std::uint32_t request_day(std::string_view calendar, Date date);
+    std::uint32_t request_conflict(std::string_view calendar, Date date,
+                                   Time::Minutes start, Time::Minutes end);
+
+    /**
+     * @brief flush writes the buffered requests to the server
+     * @return false if the connection failed
+     */
+    bool flush();
+
+    /**
+     * @brief receive waits for the next response
+     * @param response set to the response, its payload is valid
+     * until the next call
+     * @return false if the connection failed or was closed
+     */
+    bool receive(Frame& response);
+
+    /**
+     * @brief pending
+     * @return amount of requests whose response has not been received
+     */
+    std::size_t pending() const;
+
+private:
+    int fd_ = -1;
+    // requests not yet written
+    std::string output_;
+    // received bytes, the first consumed_ are already given out
+    std::string input_;
+    std::size_t consumed_ = 0;
+    std::uint32_t next_request_ = 0;
+    std::size_t pending_ = 0;
+
+    // starts a request frame with the calendar name
+    FrameBuilder start_request(Command command, std::string_view calendar, Date date);
+};
+
+#endif // CALENDARCLIENT_HH
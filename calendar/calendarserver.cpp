@@ -0,0 +1,494 @@
+#include "calendarserver.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+// size of a single read from a socket
+const size_t READ_CHUNK = 64 * 1024;
+// a client that sends more than this without reading is not read from
+const size_t MAX_PENDING_INPUT = 8 * MAX_FRAME_SIZE;
+// a client with more unwritten responses than this is not read from and
+// its requests are not run until it reads them
+const size_t MAX_PENDING_OUTPUT = 8 * MAX_FRAME_SIZE;
+
+bool are_valid_times(Time::Minutes start, Time::Minutes end)
+{
+    return start < end && Time::is_valid(start) && Time::is_valid(end);
+}
+}
+
+CalendarServer::CalendarServer(int workers)
+{
+    if (::pipe2(wake_pipe_, O_NONBLOCK | O_CLOEXEC) != 0)
+        wake_pipe_[0] = wake_pipe_[1] = -1;
+
+    if (workers <= 0)
+        workers = max(1u, thread::hardware_concurrency());
+    for (int i = 0; i < workers; ++i)
+    {
+        workers_.emplace_back(&CalendarServer::work, this);
+    }
+}
+
+CalendarServer::~CalendarServer()
+{
+    {
+        lock_guard<mutex> lock(jobs_mutex_);
+        workers_stopping_ = true;
+    }
+    jobs_ready_.notify_all();
+    for (thread& worker : workers_)
+    {
+        worker.join();
+    }
+
+    for (pair<const uint64_t, Connection>& connection : connections_)
+    {
+        ::close(connection.second.fd);
+    }
+    if (listen_fd_ >= 0)
+    {
+        ::close(listen_fd_);
+        ::unlink(socket_path_.c_str());
+    }
+    for (int fd : wake_pipe_)
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+}
+
+bool CalendarServer::listen(const string& socket_path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path) || wake_pipe_[0] < 0)
+        return false;
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+
+    // a socket file left by a server that did not stop cleanly refuses
+    // connections, a running server accepts them and keeps its socket
+    struct stat file_info;
+    if (::lstat(socket_path.c_str(), &file_info) == 0)
+    {
+        int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool stale = probe >= 0 && S_ISSOCK(file_info.st_mode) &&
+                     ::connect(probe, reinterpret_cast<sockaddr*>(&address),
+                               sizeof(address)) != 0 && errno == ECONNREFUSED;
+        if (probe >= 0)
+            ::close(probe);
+        if (!stale)
+        {
+            ::close(fd);
+            return false;
+        }
+        ::unlink(socket_path.c_str());
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    listen_fd_ = fd;
+    socket_path_ = socket_path;
+    return true;
+}
+
+/* Waits for the sockets and the wake pipe. The responses of finished
+ * jobs are written right away, the socket is only polled for writing
+ * while it does not take all of them.
+ */
+void CalendarServer::run()
+{
+    vector<pollfd> fds;
+    vector<uint64_t> ids;
+    while (!stopping_)
+    {
+        fds.clear();
+        ids.clear();
+        fds.push_back({listen_fd_, POLLIN, 0});
+        fds.push_back({wake_pipe_[0], POLLIN, 0});
+        for (const pair<const uint64_t, Connection>& connection : connections_)
+        {
+            short events = 0;
+            if (!connection.second.eof && connection.second.input.size() < MAX_PENDING_INPUT &&
+                can_take_requests(connection.second))
+                events |= POLLIN;
+            if (!connection.second.output.empty())
+                events |= POLLOUT;
+            // a closed client waiting for its job would report POLLHUP
+            // all the time, so it is left out (poll skips negative fds)
+            int fd = events != 0 ? connection.second.fd : -1;
+            fds.push_back({fd, events, 0});
+            ids.push_back(connection.first);
+        }
+
+        if (::poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (fds.at(1).revents != 0)
+        {
+            char buffer[256];
+            while (::read(wake_pipe_[0], buffer, sizeof(buffer)) > 0)
+            {
+            }
+            collect_done();
+        }
+
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            short revents = fds.at(i + 2).revents;
+            map<uint64_t, Connection>::iterator connection = connections_.find(ids.at(i));
+            if (revents == 0 || connection == connections_.end())
+                continue;
+
+            bool ok = true;
+            if (revents & (POLLIN | POLLHUP | POLLERR))
+                ok = read_client(connection->second) &&
+                     dispatch(connection->first, connection->second);
+            // requests held back for the unwritten responses can go now
+            if (ok && (revents & POLLOUT))
+                ok = write_client(connection->second) &&
+                     dispatch(connection->first, connection->second);
+            if (!ok || should_close(connection->second))
+                close_connection(connection);
+        }
+
+        if (fds.at(0).revents & POLLIN)
+            accept_clients();
+    }
+}
+
+void CalendarServer::stop()
+{
+    stopping_ = true;
+    wake();
+}
+
+void CalendarServer::wake()
+{
+    char byte = 0;
+    // a full pipe already wakes the loop
+    ssize_t result = ::write(wake_pipe_[1], &byte, 1);
+    (void)result;
+}
+
+void CalendarServer::accept_clients()
+{
+    while (true)
+    {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        Connection connection;
+        connection.fd = fd;
+        connections_.insert({next_connection_++, std::move(connection)});
+    }
+}
+
+bool CalendarServer::read_client(Connection& connection)
+{
+    char buffer[READ_CHUNK];
+    while (connection.input.size() < MAX_PENDING_INPUT)
+    {
+        ssize_t result = ::read(connection.fd, buffer, sizeof(buffer));
+        if (result > 0)
+        {
+            connection.input.append(buffer, result);
+            continue;
+        }
+        if (result == 0)
+        {
+            connection.eof = true;
+            return true;
+        }
+        if (errno == EINTR)
+            continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return true;
+}
+
+bool CalendarServer::write_client(Connection& connection)
+{
+    size_t written = 0;
+    while (written < connection.output.size())
+    {
+        ssize_t result = ::send(connection.fd, connection.output.data() + written,
+                                connection.output.size() - written, MSG_NOSIGNAL);
+        if (result >= 0)
+        {
+            written += result;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return false;
+        break;
+    }
+    connection.output.erase(0, written);
+    return true;
+}
+
+/* All complete requests go to the workers as one job. The rest of a
+ * partly received frame stays in the input. The job may only build
+ * responses up to what the connection still has room for, the requests
+ * it does not run come back to the input when it is done.
+ */
+bool CalendarServer::dispatch(uint64_t id, Connection& connection)
+{
+    if (connection.busy || !can_take_requests(connection))
+        return true;
+
+    string_view input = connection.input;
+    size_t complete = 0;
+    Frame frame;
+    long size = 0;
+    while ((size = parse_frame(input.substr(complete), frame)) > 0)
+    {
+        complete += size;
+    }
+    if (size < 0)
+        return false;
+    if (complete == 0)
+        return true;
+
+    Job job;
+    job.connection = id;
+    if (complete == connection.input.size())
+    {
+        job.requests = std::move(connection.input);
+        connection.input.clear();
+    }
+    else
+    {
+        job.requests = connection.input.substr(0, complete);
+        connection.input.erase(0, complete);
+    }
+    job.response_budget = MAX_PENDING_OUTPUT - connection.output.size();
+    connection.busy = true;
+
+    {
+        lock_guard<mutex> lock(jobs_mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobs_ready_.notify_one();
+    return true;
+}
+
+void CalendarServer::collect_done()
+{
+    vector<Job> done;
+    {
+        lock_guard<mutex> lock(done_mutex_);
+        done.swap(done_);
+    }
+
+    for (Job& job : done)
+    {
+        // the client may have gone while the job was running
+        map<uint64_t, Connection>::iterator connection = connections_.find(job.connection);
+        if (connection == connections_.end())
+            continue;
+
+        Connection& client = connection->second;
+        if (client.output.empty())
+            client.output = std::move(job.responses);
+        else
+            client.output += job.responses;
+        // the requests the job left go before those received meanwhile
+        client.input.insert(0, job.requests);
+        client.busy = false;
+
+        // written first, so the requests left by the job can go right away
+        bool ok = write_client(client) && dispatch(connection->first, client);
+        if (!ok || should_close(client))
+            close_connection(connection);
+    }
+}
+
+bool CalendarServer::can_take_requests(const Connection& connection) const
+{
+    return connection.output.size() < MAX_PENDING_OUTPUT;
+}
+
+bool CalendarServer::should_close(const Connection& connection) const
+{
+    // a client that has closed its end still gets its responses
+    return connection.eof && !connection.busy && connection.output.empty();
+}
+
+void CalendarServer::close_connection(map<uint64_t, Connection>::iterator connection)
+{
+    ::close(connection->second.fd);
+    connections_.erase(connection);
+}
+
+void CalendarServer::work()
+{
+    while (true)
+    {
+        Job job;
+        {
+            unique_lock<mutex> lock(jobs_mutex_);
+            jobs_ready_.wait(lock, [this] { return workers_stopping_ || !jobs_.empty(); });
+            if (workers_stopping_)
+                return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        size_t handled = handle(job.requests, job.responses, job.response_budget);
+        job.requests.erase(0, handled);
+        {
+            lock_guard<mutex> lock(done_mutex_);
+            done_.push_back(std::move(job));
+        }
+        wake();
+    }
+}
+
+size_t CalendarServer::handle(string_view requests, string& responses, size_t budget)
+{
+    size_t handled = 0;
+    Frame frame;
+    long size = 0;
+    while (responses.size() < budget &&
+           (size = parse_frame(requests.substr(handled), frame)) > 0)
+    {
+        handled += size;
+
+        FrameBuilder response(responses, frame.request, (uint8_t)Status::OK);
+        PayloadReader payload(frame.payload);
+        Status status = handle_request(frame.code, payload, response);
+        if (status != Status::OK)
+            response.clear_payload();
+        response.set_code((uint8_t)status);
+        response.finish();
+    }
+    return handled;
+}
+
+/* The fields added for a request that does not end OK are removed. */
+Status CalendarServer::handle_request(uint8_t code, PayloadReader& payload,
+                                      FrameBuilder& response)
+{
+    string_view name;
+    Date date;
+    if (!payload.read_text(name) || !payload.read_date(date))
+        return Status::BAD_REQUEST;
+
+    int32_t start = 0;
+    int32_t end = 0;
+    uint32_t index = 0;
+    switch ((Command)code)
+    {
+    case Command::ADD:
+    {
+        string_view event_name;
+        string_view description;
+        if (!payload.read_i32(start) || !payload.read_i32(end) ||
+            !payload.read_text(event_name) || !payload.read_text(description) ||
+            !payload.complete())
+            return Status::BAD_REQUEST;
+
+        // checked here, as Calendar would print an error message
+        if (!are_valid_times(start, end))
+            return Status::FAILED;
+        bool added = calendar(name).add_event(string(event_name), start, end,
+                                              string(description), date);
+        return added ? Status::OK : Status::FAILED;
+    }
+
+    case Command::DELETE:
+        if (!payload.read_u32(index) || !payload.complete())
+            return Status::BAD_REQUEST;
+        return calendar(name).delete_event(date, (int)min<uint32_t>(index, INT32_MAX))
+                   ? Status::OK : Status::FAILED;
+
+    case Command::MOVE:
+    {
+        Date new_date;
+        if (!payload.read_u32(index) || !payload.read_date(new_date) || !payload.complete())
+            return Status::BAD_REQUEST;
+        return calendar(name).move_event(date, (int)min<uint32_t>(index, INT32_MAX), new_date)
+                   ? Status::OK : Status::FAILED;
+    }
+
+    case Command::COUNT:
+        if (!payload.complete())
+            return Status::BAD_REQUEST;
+        response.add_u32(calendar(name).events_count(date));
+        return Status::OK;
+
+    case Command::DAY:
+    {
+        if (!payload.complete())
+            return Status::BAD_REQUEST;
+        vector<EventData> events = calendar(name).events_on(date);
+        response.add_u32(events.size());
+        for (const EventData& event : events)
+        {
+            response.add_i32(event.start).add_i32(event.end)
+                    .add_text(event.name).add_text(event.description);
+            // the client would take a larger frame for a broken one
+            if (response.length() > MAX_FRAME_SIZE)
+                return Status::TOO_LARGE;
+        }
+        return Status::OK;
+    }
+
+    case Command::CONFLICT:
+        if (!payload.read_i32(start) || !payload.read_i32(end) || !payload.complete())
+            return Status::BAD_REQUEST;
+        response.add_u8(calendar(name).has_conflict(date, start, end) ? 1 : 0);
+        return Status::OK;
+    }
+    return Status::BAD_REQUEST;
+}
+
+/* Most requests find an existing calendar with the shared lock. */
+ConcurrentCalendar& CalendarServer::calendar(string_view name)
+{
+    using Iterator = map<string, unique_ptr<ConcurrentCalendar>, less<>>::iterator;
+    {
+        shared_lock<shared_mutex> lock(calendars_mutex_);
+        Iterator found = calendars_.find(name);
+        if (found != calendars_.end())
+            return *found->second;
+    }
+
+    unique_lock<shared_mutex> lock(calendars_mutex_);
+    Iterator found = calendars_.find(name);
+    if (found == calendars_.end())
+        found = calendars_.emplace(string(name), make_unique<ConcurrentCalendar>(
+                                                     SERVER_CALENDAR_SHARDS)).first;
+    return *found->second;
+}
+
+size_t CalendarServer::calendar_count() const
+{
+    shared_lock<shared_mutex> lock(calendars_mutex_);
+    return calendars_.size();
+}
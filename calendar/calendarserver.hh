@@ -0,0 +1,169 @@
+/*
+ * Class CalendarServer
+ * ----------
+ * The calendar daemon. It hosts many named calendars and serves
+ * clients over a Unix domain socket with the framed protocol of
+ * protocol.hh.
+ *
+ * One thread runs the event loop: it accepts connections and reads
+ * and writes the sockets with poll(). The complete requests received
+ * from a connection are handed to a pool of worker threads as one
+ * job, and all responses of the job are written back together. A
+ * connection has at most one job at a time, so its responses stay
+ * in order while different connections are served in parallel.
+ * A client that does not read its responses is not read from, nor
+ * are its requests run, until its unwritten responses get small.
+ * A job also stops once its responses fill the room that is left,
+ * and its other requests wait for the next job of the connection.
+ * Calendars are ConcurrentCalendars, so requests to the same
+ * calendar run in parallel too.
+ */
+
+#ifndef CALENDARSERVER_HH
+#define CALENDARSERVER_HH
+
+#include "concurrentcalendar.hh"
+#include "protocol.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// shards of each hosted calendar
+const int SERVER_CALENDAR_SHARDS = 16;
+
+class CalendarServer
+{
+public:
+    /**
+     * @brief CalendarServer starts the worker threads
+     * @param workers amount of worker threads, 0 for one per hardware thread
+     */
+    explicit CalendarServer(int workers = 0);
+    ~CalendarServer();
+
+    CalendarServer(const CalendarServer&) = delete;
+    CalendarServer& operator=(const CalendarServer&) = delete;
+
+    /**
+     * @brief listen creates the socket. A socket file left by a server
+     * that did not stop cleanly is replaced, but not the socket of a
+     * server that is still running.
+     * @param socket_path path of the socket, removed when the server is destroyed
+     * @return false if the socket could not be created or is in use
+     */
+    bool listen(const std::string& socket_path);
+
+    /**
+     * @brief run serves clients until stop() is called
+     */
+    void run();
+
+    /**
+     * @brief stop makes run() return. Safe to call from any thread
+     * and from a signal handler.
+     */
+    void stop();
+
+    /**
+     * @brief handle runs requests and builds their responses. It stops
+     * once the responses reach the budget, so the last response may
+     * go over it by up to one frame.
+     * @param requests complete request frames
+     * @param responses a response frame is appended for each request run
+     * @param budget bytes of responses after which no more requests are run
+     * @return length of the requests that were run
+     */
+    std::size_t handle(std::string_view requests, std::string& responses,
+                       std::size_t budget = SIZE_MAX);
+
+    /**
+     * @brief calendar_count
+     * @return amount of calendars created by requests
+     */
+    std::size_t calendar_count() const;
+
+private:
+    struct Connection
+    {
+        int fd = -1;
+        // received bytes not yet handed to a worker
+        std::string input;
+        // responses not yet written
+        std::string output;
+        // true while a worker has requests of the connection
+        bool busy = false;
+        // true after the client has closed its end
+        bool eof = false;
+    };
+
+    struct Job
+    {
+        std::uint64_t connection = 0;
+        std::string requests;
+        std::string responses;
+        // the requests stop once the responses reach this
+        std::size_t response_budget = 0;
+    };
+
+    int listen_fd_ = -1;
+    // workers and stop() wake the event loop through this pipe
+    int wake_pipe_[2] = {-1, -1};
+    std::string socket_path_;
+    std::atomic<bool> stopping_{false};
+
+    // only used by the event loop thread
+    std::map<std::uint64_t, Connection> connections_;
+    std::uint64_t next_connection_ = 0;
+
+    std::vector<std::thread> workers_;
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_ready_;
+    std::deque<Job> jobs_;
+    bool workers_stopping_ = false;
+    // finished jobs waiting for the event loop
+    std::mutex done_mutex_;
+    std::vector<Job> done_;
+
+    mutable std::shared_mutex calendars_mutex_;
+    std::map<std::string, std::unique_ptr<ConcurrentCalendar>, std::less<>> calendars_;
+
+    // runs jobs until the server is destroyed
+    void work();
+    // wakes the event loop
+    void wake();
+    // gives the calendar of the name, creating it if needed
+    ConcurrentCalendar& calendar(std::string_view name);
+    // runs a request and adds the result fields to the response
+    Status handle_request(std::uint8_t code, PayloadReader& payload,
+                          FrameBuilder& response);
+
+    void accept_clients();
+    // reads what the client has sent, false if the connection failed
+    bool read_client(Connection& connection);
+    // writes what the socket takes, false if the connection failed
+    bool write_client(Connection& connection);
+    // hands the complete requests to the workers, false if a frame is invalid.
+    // The responses of a job may fill what is left of MAX_PENDING_OUTPUT.
+    bool dispatch(std::uint64_t id, Connection& connection);
+    // true while the responses of the connection are not written too far behind
+    bool can_take_requests(const Connection& connection) const;
+    // moves the responses of finished jobs to their connections
+    void collect_done();
+    // true when the connection is broken or finished with
+    bool should_close(const Connection& connection) const;
+    void close_connection(std::map<std::uint64_t, Connection>::iterator connection);
+};
+
+#endif // CALENDARSERVER_HH
@@ -0,0 +1,180 @@
+#include "concurrentcalendar.hh"
+#include "dayordinal.hh"
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+
+using namespace std;
+
+/* There is no undo through the shards, so they keep no history and
+ * the slots of deleted events are reused at once.
+ */
+ConcurrentCalendar::ConcurrentCalendar(int shard_count):
+    shards_(max(shard_count, 1))
+{
+    for (Shard& shard : shards_)
+    {
+        shard.calendar.set_history_budget(0);
+    }
+}
+
+/* Consecutive months go to different shards. */
+size_t ConcurrentCalendar::shard_index(Date date) const
+{
+    size_t month_key = date.year() * 12 + date.month() - 1;
+    return month_key % shards_.size();
+}
+
+ConcurrentCalendar::Shard& ConcurrentCalendar::shard_of(Date date)
+{
+    return shards_.at(shard_index(date));
+}
+
+const ConcurrentCalendar::Shard& ConcurrentCalendar::shard_of(Date date) const
+{
+    return shards_.at(shard_index(date));
+}
+
+bool ConcurrentCalendar::add_event(const string& name, Time::Minutes start,
+                                   Time::Minutes end, const string& description,
+                                   Date date)
+{
+    Shard& shard = shard_of(date);
+    unique_lock<shared_mutex> lock(shard.mutex);
+    return shard.calendar.add_event(name, start, end, description, date);
+}
+
+/* Splits the events by shard and adds each part as one batch. */
+int ConcurrentCalendar::add_events(const vector<EventData>& events)
+{
+    vector<vector<EventData>> batches(shards_.size());
+    for (const EventData& event : events)
+    {
+        batches.at(shard_index(event.date)).push_back(event);
+    }
+
+    int added = 0;
+    for (size_t i = 0; i < shards_.size(); ++i)
+    {
+        if (batches.at(i).empty())
+            continue;
+
+        unique_lock<shared_mutex> lock(shards_.at(i).mutex);
+        added += shards_.at(i).calendar.add_events(std::move(batches.at(i)));
+    }
+    return added;
+}
+
+bool ConcurrentCalendar::delete_event(Date date, int i)
+{
+    if (!Date::is_valid_date(date.day(), date.month(), date.year()))
+        return false;
+
+    Shard& shard = shard_of(date);
+    unique_lock<shared_mutex> lock(shard.mutex);
+    shard.calendar.change_date(date);
+    return shard.calendar.delete_event(i);
+}
+
+/* Within a shard the event is moved as in Calendar. Between shards it is
+ * copied to the new shard and deleted from the old one while both are locked.
+ */
+bool ConcurrentCalendar::move_event(Date date, int i, Date new_date)
+{
+    if (!Date::is_valid_date(date.day(), date.month(), date.year()) ||
+        !Date::is_valid_date(new_date.day(), new_date.month(), new_date.year()))
+        return false;
+
+    Shard& source = shard_of(date);
+    Shard& target = shard_of(new_date);
+    if (&source == &target)
+    {
+        unique_lock<shared_mutex> lock(source.mutex);
+        source.calendar.change_date(date);
+        return source.calendar.move_event(i, new_date);
+    }
+
+    // scoped_lock locks both without deadlocking with a move the other way
+    scoped_lock<shared_mutex, shared_mutex> lock(source.mutex, target.mutex);
+    source.calendar.change_date(date);
+    EventId id = 0;
+    if (!source.calendar.event_id(i, id))
+        return false;
+
+    // the event is deleted only once its copy is in the new shard
+    const Event& event = source.calendar.event(id);
+    if (!target.calendar.add_event(event.name(), event.start(), event.end(),
+                                   event.description(), new_date))
+        return false;
+    return source.calendar.delete_by_id(id);
+}
+
+int ConcurrentCalendar::events_count(Date date) const
+{
+    const Shard& shard = shard_of(date);
+    shared_lock<shared_mutex> lock(shard.mutex);
+    assert(!shard.calendar.has_unloaded_days());
+    return shard.calendar.loaded_events_count(date);
+}
+
+vector<EventData> ConcurrentCalendar::events_on(Date date) const
+{
+    vector<EventData> events;
+    const Shard& shard = shard_of(date);
+    shared_lock<shared_mutex> lock(shard.mutex);
+    copy_events(shard.calendar, date, date, events);
+    return events;
+}
+
+/* Goes through the range one month (and shard) at a time. */
+vector<EventData> ConcurrentCalendar::events_in_range(Date from, Date to) const
+{
+    vector<EventData> events;
+    int last = day_ordinal(to);
+    int ordinal = day_ordinal(from);
+    while (ordinal <= last)
+    {
+        Date first_day = date_from_ordinal(ordinal);
+        Date month_end(Date::days_in_month(first_day.month(), first_day.year()),
+                       first_day.month(), first_day.year());
+        Date last_day = day_ordinal(month_end) < last ? month_end : to;
+
+        const Shard& shard = shard_of(first_day);
+        {
+            shared_lock<shared_mutex> lock(shard.mutex);
+            copy_events(shard.calendar, first_day, last_day, events);
+        }
+        ordinal = day_ordinal(last_day) + 1;
+    }
+    return events;
+}
+
+bool ConcurrentCalendar::has_conflict(Date date, Time::Minutes start, Time::Minutes end)
+{
+    Shard& shard = shard_of(date);
+    unique_lock<shared_mutex> lock(shard.mutex);
+    return shard.calendar.has_conflict(date, start, end);
+}
+
+int ConcurrentCalendar::size() const
+{
+    int events = 0;
+    for (const Shard& shard : shards_)
+    {
+        shared_lock<shared_mutex> lock(shard.mutex);
+        events += shard.calendar.memory_usage().events;
+    }
+    return events;
+}
+
+/* The shared lock allows only queries that load nothing. */
+void ConcurrentCalendar::copy_events(const Calendar& calendar, Date from, Date to,
+                                     vector<EventData>& events)
+{
+    assert(!calendar.has_unloaded_days());
+    for (const Event& event : calendar.loaded_events_in_range(from, to))
+    {
+        events.push_back({event.date(), event.name(), event.start(),
+                          event.end(), event.description()});
+    }
+}
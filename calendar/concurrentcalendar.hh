@@ -0,0 +1,113 @@
+/*
+ * Class ConcurrentCalendar
+ * ----------
+ * A calendar that can be used from many threads at once.
+ * The events are split into shards by month, each shard being
+ * its own Calendar (with its own event pool and days) behind a
+ * reader-writer lock. Reads of a month only take the shared lock
+ * of its shard, so queries on different dates run in parallel
+ * with each other and with changes to other months.
+ *
+ * Reads use the const queries of Calendar that never load days,
+ * so they change nothing under the shared lock. Shards have no
+ * snapshot days or series, so those queries see every event.
+ *
+ * There is no chosen date, every call names the date it uses.
+ * Results are returned as copies, as views to the events would
+ * not be safe after the lock is released. A range query locks
+ * one month at a time, so it sees each month in a consistent
+ * state but not necessarily the whole range.
+ */
+
+#ifndef CONCURRENTCALENDAR_HH
+#define CONCURRENTCALENDAR_HH
+
+#include "calendar.hh"
+
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+class ConcurrentCalendar
+{
+public:
+    /**
+     * @brief ConcurrentCalendar
+     * @param shard_count amount of shards, months are spread over them
+     */
+    explicit ConcurrentCalendar(int shard_count = 64);
+
+    /**
+     * @brief add_event adds an event for the given date
+     * @return false if times are invalid or start >= end
+     */
+    bool add_event(const std::string& name, Time::Minutes start, Time::Minutes end,
+                   const std::string& description, Date date);
+
+    /**
+     * @brief add_events adds many events, locking each shard only once
+     * @return amount of events added
+     */
+    int add_events(const std::vector<EventData>& events);
+
+    /**
+     * @brief delete_event deletes the i:th event of a date
+     * @return false if there is no such event
+     */
+    bool delete_event(Date date, int i);
+
+    /**
+     * @brief move_event moves the i:th event of a date to a new date.
+     * If the dates are in different shards, both are locked.
+     * @return false if there is no such event or the new date is invalid
+     */
+    bool move_event(Date date, int i, Date new_date);
+
+    int events_count(Date date) const;
+
+    /**
+     * @brief events_on
+     * @return copies of the events of the date ordered by time
+     */
+    std::vector<EventData> events_on(Date date) const;
+
+    /**
+     * @brief events_in_range gives the events between two dates
+     * @param to last date of the range (included)
+     * @return copies of the events ordered by date and time
+     */
+    std::vector<EventData> events_in_range(Date from, Date to) const;
+
+    /**
+     * @brief has_conflict checks if a time range of a date is taken.
+     * Takes the exclusive lock, as the Calendar query may load the day.
+     * @return true if some event overlaps the range
+     */
+    bool has_conflict(Date date, Time::Minutes start, Time::Minutes end);
+
+    /**
+     * @brief size
+     * @return amount of events in all shards
+     */
+    int size() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex;
+        // changed only under the exclusive lock
+        Calendar calendar;
+    };
+    std::vector<Shard> shards_;
+
+    // shard of the month of the date
+    std::size_t shard_index(Date date) const;
+    Shard& shard_of(Date date);
+    const Shard& shard_of(Date date) const;
+    // copies the events of a range that is inside one month
+    static void copy_events(const Calendar& calendar, Date from, Date to,
+                            std::vector<EventData>& events);
+};
+
+#endif // CONCURRENTCALENDAR_HH
@@ -0,0 +1,437 @@
+#include "dayevents.hh"
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+namespace
+{
+/* Priority of a tree node. A hash of the slot mixes the priorities
+ * well enough to keep the tree balanced, and needs no storage.
+ */
+uint32_t priority(int node)
+{
+    uint32_t hash = (uint32_t)node + 0x9e3779b9u;
+    hash = (hash ^ (hash >> 16)) * 0x85ebca6bu;
+    hash = (hash ^ (hash >> 13)) * 0xc2b2ae35u;
+    return hash ^ (hash >> 16);
+}
+}
+
+/* A helper function that sorts events by time.
+ * Returns true if event1 should come before event2.
+ */
+bool compare_events_by_time(const DayEntry& event1, const DayEntry& event2)
+{
+    if (event1.start != event2.start) {
+        return event1.start < event2.start;
+    }
+    return event1.end < event2.end;
+}
+
+/* Places the event after all events that have the same or earlier time. */
+void DayEvents::insert(const DayEntry& event)
+{
+    vector<DayEntry>::iterator position =
+        upper_bound(events_.begin(), events_.end(), event, compare_events_by_time);
+    int index = (int)(position - events_.begin());
+    events_.insert(position, event);
+
+    int left = -1;
+    int right = -1;
+    split(root_, index, left, right);
+    root_ = merge(merge(left, new_node(event)), right);
+}
+
+/* Sorts the batch once and merges it with the already sorted events. */
+void DayEvents::insert_batch(vector<DayEntry> batch)
+{
+    if (batch.empty())
+        return;
+
+    // stable sort keeps the adding order of events with same times
+    if (!is_sorted(batch.begin(), batch.end(), compare_events_by_time))
+        stable_sort(batch.begin(), batch.end(), compare_events_by_time);
+
+    int old_size = (int)events_.size();
+    events_.insert(events_.end(), batch.begin(), batch.end());
+
+    // old events come first when times are equal, same as with insert()
+    inplace_merge(events_.begin(), events_.begin() + old_size,
+                  events_.end(), compare_events_by_time);
+    build_index();
+}
+
+void DayEvents::erase(int index)
+{
+    events_.erase(events_.begin() + index);
+
+    int left = -1;
+    int middle = -1;
+    int right = -1;
+    split(root_, index, left, right);
+    split(right, 1, middle, right);
+    free_nodes_.push_back(middle);
+    root_ = merge(left, right);
+}
+
+int DayEvents::new_node(const DayEntry& event)
+{
+    int node = (int)nodes_.size();
+    if (!free_nodes_.empty())
+    {
+        node = free_nodes_.back();
+        free_nodes_.pop_back();
+    }
+    else
+    {
+        nodes_.push_back(IndexNode());
+    }
+    nodes_.at(node) = {event.start, event.end, event.start, event.end, 0, 1,
+                       event.cached ? 0 : 1, event.cached, -1, -1};
+    return node;
+}
+
+/* The free times of a subtree are the ones inside its children and
+ * the ones between the children and the node's own event.
+ */
+void DayEvents::update(int node)
+{
+    IndexNode& current = nodes_.at(node);
+    current.first_start = current.start;
+    current.max_end = current.end;
+    current.gap = 0;
+    current.size = 1;
+    current.stored = current.cached ? 0 : 1;
+    if (current.left != -1)
+    {
+        const IndexNode& left = nodes_.at(current.left);
+        current.first_start = left.first_start;
+        current.gap = max(left.gap, current.start - left.max_end);
+        current.max_end = max(left.max_end, current.end);
+        current.size += left.size;
+        current.stored += left.stored;
+    }
+    if (current.right != -1)
+    {
+        const IndexNode& right = nodes_.at(current.right);
+        current.gap = max({current.gap, right.gap, right.first_start - current.max_end});
+        current.max_end = max(current.max_end, right.max_end);
+        current.size += right.size;
+        current.stored += right.stored;
+    }
+}
+
+void DayEvents::split(int node, int count, int& left, int& right)
+{
+    if (node == -1)
+    {
+        left = -1;
+        right = -1;
+        return;
+    }
+    IndexNode& current = nodes_.at(node);
+    int left_size = current.left == -1 ? 0 : nodes_.at(current.left).size;
+    if (count <= left_size)
+    {
+        split(current.left, count, left, nodes_.at(node).left);
+        right = node;
+    }
+    else
+    {
+        split(current.right, count - left_size - 1, nodes_.at(node).right, right);
+        left = node;
+    }
+    update(node);
+}
+
+int DayEvents::merge(int left, int right)
+{
+    if (left == -1)
+        return right;
+    if (right == -1)
+        return left;
+    if (priority(left) > priority(right))
+    {
+        int joined = merge(nodes_.at(left).right, right);
+        nodes_.at(left).right = joined;
+        update(left);
+        return left;
+    }
+    int joined = merge(left, nodes_.at(right).left);
+    nodes_.at(right).left = joined;
+    update(right);
+    return right;
+}
+
+/* Builds the tree in one pass over the sorted events. The stack holds
+ * the rightmost path of the tree built so far.
+ */
+void DayEvents::build_index()
+{
+    nodes_.clear();
+    free_nodes_.clear();
+    nodes_.reserve(events_.size());
+
+    vector<int> right_path;
+    for (const DayEntry& event : events_)
+    {
+        int node = new_node(event);
+        int last_popped = -1;
+        while (!right_path.empty() && priority(right_path.back()) < priority(node))
+        {
+            last_popped = right_path.back();
+            right_path.pop_back();
+            update(last_popped);
+        }
+        nodes_.at(node).left = last_popped;
+        if (!right_path.empty())
+            nodes_.at(right_path.back()).right = node;
+        right_path.push_back(node);
+    }
+    while (right_path.size() > 1)
+    {
+        update(right_path.back());
+        right_path.pop_back();
+    }
+    root_ = -1;
+    if (!right_path.empty())
+    {
+        root_ = right_path.front();
+        update(root_);
+    }
+}
+
+Time::Minutes DayEvents::max_end_before(int count) const
+{
+    Time::Minutes result = 0;
+    int node = root_;
+    while (node != -1 && count > 0)
+    {
+        const IndexNode& current = nodes_.at(node);
+        int left_size = current.left == -1 ? 0 : nodes_.at(current.left).size;
+        if (count <= left_size)
+        {
+            node = current.left;
+            continue;
+        }
+        if (current.left != -1)
+            result = max(result, nodes_.at(current.left).max_end);
+        result = max(result, current.end);
+        count -= left_size + 1;
+        node = current.right;
+    }
+    return result;
+}
+
+int DayEvents::stored_before(int count) const
+{
+    int result = 0;
+    int node = root_;
+    while (node != -1 && count > 0)
+    {
+        const IndexNode& current = nodes_.at(node);
+        int left_size = current.left == -1 ? 0 : nodes_.at(current.left).size;
+        if (count <= left_size)
+        {
+            node = current.left;
+            continue;
+        }
+        if (current.left != -1)
+            result += nodes_.at(current.left).stored;
+        if (!current.cached)
+            result++;
+        count -= left_size + 1;
+        node = current.right;
+    }
+    return result;
+}
+
+int DayEvents::stored_index(int position) const
+{
+    if (position <= 0 || root_ == -1 || position > nodes_.at(root_).stored)
+        return -1;
+
+    int index = 0;
+    int node = root_;
+    while (true)
+    {
+        const IndexNode& current = nodes_.at(node);
+        int left_size = current.left == -1 ? 0 : nodes_.at(current.left).size;
+        int left_stored = current.left == -1 ? 0 : nodes_.at(current.left).stored;
+        if (position <= left_stored)
+        {
+            node = current.left;
+            continue;
+        }
+        position -= left_stored;
+        if (!current.cached && --position == 0)
+            return index + left_size;
+        index += left_size + 1;
+        node = current.right;
+    }
+}
+
+/* A subtree is skipped when the busy time before it covers all of it
+ * or none of its free times is long enough. At most one path of the
+ * tree is partly covered, so the search stays logarithmic.
+ */
+bool DayEvents::find_gap(int node, Time::Minutes duration, Time::Minutes& busy_until,
+                         Time::Minutes& slot_start) const
+{
+    if (node == -1)
+        return false;
+    const IndexNode& current = nodes_.at(node);
+    if (busy_until >= current.max_end)
+        return false;
+    if (current.first_start - busy_until < duration && current.gap < duration)
+    {
+        busy_until = current.max_end;
+        return false;
+    }
+
+    if (find_gap(current.left, duration, busy_until, slot_start))
+        return true;
+    if (current.start - busy_until >= duration)
+    {
+        slot_start = busy_until;
+        return true;
+    }
+    busy_until = max(busy_until, current.end);
+    return find_gap(current.right, duration, busy_until, slot_start);
+}
+
+int DayEvents::count_starting_before(Time::Minutes time) const
+{
+    vector<DayEntry>::const_iterator iter = partition_point(
+        events_.begin(), events_.end(),
+        [time](const DayEntry& event) { return event.start < time; });
+    return (int)(iter - events_.begin());
+}
+
+/* A subtree is skipped when all of its events end at latest at the
+ * range start or start at earliest at the range end. Every node that
+ * is visited has an overlapping event in its subtree or is on one of
+ * the two boundary paths, so the search is logarithmic plus the
+ * amount of events found.
+ */
+void DayEvents::collect_overlapping(int node, int index, Time::Minutes start,
+                                    Time::Minutes end, vector<EventId>& result) const
+{
+    if (node == -1)
+        return;
+    const IndexNode& current = nodes_.at(node);
+    if (current.max_end <= start || current.first_start >= end)
+        return;
+
+    int left_size = current.left == -1 ? 0 : nodes_.at(current.left).size;
+    collect_overlapping(current.left, index, start, end, result);
+    // the events after this one start at the same time or later
+    if (current.start >= end)
+        return;
+    if (current.end > start)
+        result.push_back(events_.at(index + left_size).id);
+    collect_overlapping(current.right, index + left_size + 1, start, end, result);
+}
+
+/* Returns the events that overlap the range [start, end). */
+vector<EventId> DayEvents::overlapping(Time::Minutes start, Time::Minutes end) const
+{
+    vector<EventId> result;
+    collect_overlapping(root_, 0, start, end, result);
+    return result;
+}
+
+/* Checks if any event overlaps the range [start, end). */
+bool DayEvents::has_conflict(Time::Minutes start, Time::Minutes end) const
+{
+    int last = count_starting_before(end);
+    // some event starting before the range end also ends after the range start
+    return last > 0 && max_end_before(last) > start;
+}
+
+/* Finds the earliest free time of at least the given duration. */
+bool DayEvents::find_free_slot(Time::Minutes duration, Time::Minutes& slot_start) const
+{
+    Time::Minutes busy_until = 0;
+    if (find_gap(root_, duration, busy_until, slot_start))
+        return true;
+    // free time after the last event
+    slot_start = busy_until;
+    return busy_until + duration <= DAY_END;
+}
+
+/* Finds the event among the events that have the same times. */
+int DayEvents::find(const DayEntry& event) const
+{
+    pair<vector<DayEntry>::const_iterator, vector<DayEntry>::const_iterator> same_times =
+        equal_range(events_.begin(), events_.end(), event, compare_events_by_time);
+    for (vector<DayEntry>::const_iterator iter = same_times.first;
+         iter != same_times.second; ++iter)
+    {
+        if (iter->id == event.id)
+            return (int)(iter - events_.begin());
+    }
+    return -1;
+}
+
+/* Removes the events in one pass, keeping the order of the others. */
+vector<int> DayEvents::remove_ids(const unordered_set<EventId>& ids,
+                                  vector<DayEntry>& removed)
+{
+    vector<int> indices;
+    size_t kept = 0;
+    for (size_t i = 0; i < events_.size(); ++i)
+    {
+        if (ids.count(events_.at(i).id) != 0)
+        {
+            removed.push_back(events_.at(i));
+            indices.push_back((int)i);
+        }
+        else
+        {
+            events_.at(kept++) = events_.at(i);
+        }
+    }
+    events_.resize(kept);
+    if (!indices.empty())
+        build_index();
+    return indices;
+}
+
+void DayEvents::set_id(int index, EventId id)
+{
+    events_.at(index).id = id;
+}
+
+const DayEntry& DayEvents::at(int index) const
+{
+    return events_.at(index);
+}
+
+int DayEvents::size() const
+{
+    return (int)events_.size();
+}
+
+bool DayEvents::empty() const
+{
+    return events_.empty();
+}
+
+size_t DayEvents::bytes() const
+{
+    return events_.capacity() * sizeof(DayEntry) +
+           nodes_.capacity() * sizeof(IndexNode) +
+           free_nodes_.capacity() * sizeof(int);
+}
+
+vector<DayEntry>::const_iterator DayEvents::begin() const
+{
+    return events_.begin();
+}
+
+vector<DayEntry>::const_iterator DayEvents::end() const
+{
+    return events_.end();
+}
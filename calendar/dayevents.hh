@@ -0,0 +1,209 @@
+/*
+ * DayEvents holds the events of a single day and keeps
+ * them ordered by start time (and end time for equal starts).
+ * Each event is stored as a small entry with its times and
+ * handle, so ordering never needs to look at the events.
+ * New events are placed with a binary search, so adding
+ * an event never re-sorts the whole day. Events with equal
+ * times stay in the order they were added.
+ *
+ * For overlap and free time queries the class keeps an index:
+ * a balanced tree (treap) with a node for each event in the same
+ * order as the events. Each node knows the earliest start, the
+ * latest end and the longest free time between the events of its
+ * subtree. A single insert or erase updates only the nodes on one
+ * path of the tree, so both changes and queries are logarithmic.
+ * Batch changes build the tree again in linear time. The tree
+ * also counts the events that are not marked cached, so the
+ * position of an event among them is found without a scan.
+ */
+
+#ifndef DAYEVENTS_HH
+#define DAYEVENTS_HH
+
+#include "event.hh"
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+// an event of a day: its times and handle in the event pool
+struct DayEntry
+{
+    Time::Minutes start;
+    Time::Minutes end;
+    EventId id;
+    // the event can be created again from elsewhere (an occurrence of
+    // a repeating event), so it is not stored on its own
+    bool cached = false;
+};
+
+// the minute when a day ends, events must end at latest at this time
+const Time::Minutes DAY_END = 24 * 60;
+
+class DayEvents
+{
+public:
+    /**
+     * @brief insert places a single event to its sorted position
+     * @param event the event to be added
+     */
+    void insert(const DayEntry& event);
+
+    /**
+     * @brief insert_batch adds many events at once.
+     * The batch is sorted once and merged with the existing events,
+     * which gives the same order as inserting them one by one.
+     * @param batch events to be added
+     */
+    void insert_batch(std::vector<DayEntry> batch);
+
+    /**
+     * @brief erase removes the event at the given index
+     * @param index 0-based index of the event
+     */
+    void erase(int index);
+
+    /**
+     * @brief find finds the index of an event with a binary search
+     * @param event entry of the event (times and handle)
+     * @return 0-based index of the event, -1 if not found
+     */
+    int find(const DayEntry& event) const;
+
+    /**
+     * @brief remove_ids removes all events whose handle is in ids
+     * with a single pass over the day
+     * @param ids handles of the events to be removed
+     * @param removed removed entries are added here in time order
+     * @return original 0-based indices of the removed events in order
+     */
+    std::vector<int> remove_ids(const std::unordered_set<EventId>& ids,
+                                std::vector<DayEntry>& removed);
+
+    /**
+     * @brief set_id changes the handle of the event at the given index
+     * @param index 0-based index of the event
+     * @param id new handle of the event
+     */
+    void set_id(int index, EventId id);
+
+    /**
+     * @brief stored_before
+     * @param count amount of events from the beginning of the day
+     * @return amount of events among them that are not cached
+     */
+    int stored_before(int count) const;
+
+    /**
+     * @brief stored_index finds an event by its position among the
+     * events that are not cached
+     * @param position 1-based position among those events
+     * @return 0-based index of the event, -1 if there is no such event
+     */
+    int stored_index(int position) const;
+
+    /**
+     * @brief at a getter function
+     * @param index 0-based index of the event
+     * @return entry of the event at the index
+     */
+    const DayEntry& at(int index) const;
+
+    /**
+     * @brief overlapping finds events that overlap the time range
+     * @param start beginning of the range
+     * @param end end of the range (exclusive)
+     * @return handles of overlapping events ordered by time
+     */
+    std::vector<EventId> overlapping(Time::Minutes start, Time::Minutes end) const;
+
+    /**
+     * @brief has_conflict checks if any event overlaps the time range
+     * @param start beginning of the range
+     * @param end end of the range (exclusive)
+     * @return true if there is an overlapping event
+     */
+    bool has_conflict(Time::Minutes start, Time::Minutes end) const;
+
+    /**
+     * @brief find_free_slot finds the earliest free time of the day
+     * @param duration required length of the free time
+     * @param slot_start set to the beginning of the free time if found
+     * @return true if a free slot was found
+     */
+    bool find_free_slot(Time::Minutes duration, Time::Minutes& slot_start) const;
+
+    int size() const;
+    bool empty() const;
+
+    /**
+     * @brief bytes
+     * @return memory used by the entries in bytes
+     */
+    std::size_t bytes() const;
+
+    std::vector<DayEntry>::const_iterator begin() const;
+    std::vector<DayEntry>::const_iterator end() const;
+
+private:
+    // a node of the index tree, the in-order position of the node
+    // is the index of its event in events_
+    struct IndexNode
+    {
+        Time::Minutes start;
+        Time::Minutes end;
+        // earliest start, latest end and longest free time between
+        // the events of the subtree
+        Time::Minutes first_start;
+        Time::Minutes max_end;
+        Time::Minutes gap;
+        // amount of events in the subtree, and of those not cached
+        int size;
+        int stored;
+        bool cached;
+        int left;
+        int right;
+    };
+
+    // events of the day ordered by time
+    std::vector<DayEntry> events_;
+
+    // nodes of the index tree, -1 is an empty subtree
+    std::vector<IndexNode> nodes_;
+    // slots of erased nodes, reused by new nodes
+    std::vector<int> free_nodes_;
+    int root_ = -1;
+
+    // creates a node without children for the event
+    int new_node(const DayEntry& event);
+    // recomputes the summary of a node from its children
+    void update(int node);
+    // splits the subtree so that its first count events go to left
+    void split(int node, int count, int& left, int& right);
+    // joins two subtrees, all events of left come first
+    int merge(int left, int right);
+    // builds the tree again from events_
+    void build_index();
+
+    // latest end time among the first count events
+    Time::Minutes max_end_before(int count) const;
+    // finds the first free time of the duration in the subtree,
+    // busy_until is the end of the busy time before the subtree
+    bool find_gap(int node, Time::Minutes duration, Time::Minutes& busy_until,
+                  Time::Minutes& slot_start) const;
+    // amount of events starting before the given time
+    int count_starting_before(Time::Minutes time) const;
+    // adds the events of the subtree that overlap [start, end) to result
+    // in time order, index is the position of the first event of the subtree
+    void collect_overlapping(int node, int index, Time::Minutes start,
+                             Time::Minutes end, std::vector<EventId>& result) const;
+};
+
+/**
+ * @brief compare_events_by_time
+ * @return true if event1 should come before event2
+ */
+bool compare_events_by_time(const DayEntry& event1, const DayEntry& event2);
+
+#endif // DAYEVENTS_HH
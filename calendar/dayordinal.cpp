@@ -0,0 +1,37 @@
+#include "dayordinal.hh"
+
+// Conversions use the proleptic Gregorian calendar counted in 400 year
+// eras, which makes them work without any loops or tables.
+
+int day_ordinal(int day, int month, int year)
+{
+    // count years from March so that the leap day is the last day of a year
+    year -= month <= 2 ? 1 : 0;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    // 719468 days between 1.3.0000 and 1.1.1970
+    return era * 146097 + day_of_era - 719468;
+}
+
+int day_ordinal(const Date& date)
+{
+    return day_ordinal(date.day(), date.month(), date.year());
+}
+
+Date date_from_ordinal(int ordinal)
+{
+    ordinal += 719468;
+    int era = (ordinal >= 0 ? ordinal : ordinal - 146096) / 146097;
+    int day_of_era = ordinal - era * 146097;
+    int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524
+                       - day_of_era / 146096) / 365;
+    int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int month_index = (5 * day_of_year + 2) / 153;
+
+    int day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    int month = month_index < 10 ? month_index + 3 : month_index - 9;
+    int year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+    return Date(day, month, year);
+}
@@ -0,0 +1,33 @@
+/*
+ * Helper functions for converting dates to day ordinals
+ * and back. A day ordinal is the number of days since
+ * 1.1.1970, so consecutive dates have consecutive ordinals
+ * and comparing or storing dates only needs a single int.
+ */
+
+#ifndef DAYORDINAL_HH
+#define DAYORDINAL_HH
+
+#include "date.hh"
+
+/**
+ * @brief day_ordinal
+ * @param date the date to convert
+ * @return days since 1.1.1970 (negative for earlier dates)
+ */
+int day_ordinal(const Date& date);
+
+/**
+ * @brief day_ordinal
+ * @return days since 1.1.1970 of the given day, month and year
+ */
+int day_ordinal(int day, int month, int year);
+
+/**
+ * @brief date_from_ordinal
+ * @param ordinal days since 1.1.1970
+ * @return the date of the ordinal
+ */
+Date date_from_ordinal(int ordinal);
+
+#endif // DAYORDINAL_HH
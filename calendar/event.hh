@@ -1,34 +1,51 @@
-#ifndef EVENT_HH
-#define EVENT_HH
-
-#include "date.hh"
-#include "time.hh"
-
-#include <string>
-
-class Event
-{
-public:
-    // Constructor
-    Event(Date date, std::string name_, Time::Minutes start,
-        Time::Minutes end, std::string description);
-
-    // getters
-    const Date& date() const;
-    const std::string& name() const;
-    const std::string& description() const;
-    Time::Minutes start() const;
-    Time::Minutes end() const;
-
-    // sets event date to new date
-    void set_date(const Date& new_date);
-
-private:
-    Date date_;
-    std::string name_;
-    Time::Minutes start_;
-    Time::Minutes end_;
-    std::string description_;
-};
-
+#ifndef EVENT_HH
+#define EVENT_HH
+
+#include "date.hh"
+#include "time.hh"
+
+#include <cstdint>
+#include <string>
+
+// handle of an event stored in a Calendar: slot index and its
+// generation (see eventpool.hh)
+using EventId = std::uint64_t;
+
+// Data of an event that is not yet stored in a calendar,
+// used when adding many events at once.
+struct EventData
+{
+    Date date;
+    std::string name;
+    Time::Minutes start;
+    Time::Minutes end;
+    std::string description;
+};
+
+class Event
+{
+public:
+    // Constructor, name and description are interned strings owned by
+    // the pool of the calendar and must outlive the event
+    Event(Date date, const std::string* name, Time::Minutes start,
+        Time::Minutes end, const std::string* description);
+
+    // getters
+    const Date& date() const;
+    const std::string& name() const;
+    const std::string& description() const;
+    Time::Minutes start() const;
+    Time::Minutes end() const;
+
+    // sets event date to new date
+    void set_date(const Date& new_date);
+
+private:
+    Date date_;
+    const std::string* name_;
+    Time::Minutes start_;
+    Time::Minutes end_;
+    const std::string* description_;
+};
+
 #endif // EVENT_HH
\ No newline at end of file
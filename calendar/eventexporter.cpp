@@ -0,0 +1,168 @@
+#include "eventexporter.hh"
+
+using namespace std;
+
+EventExporter::EventExporter(streambuf& sink, ExportFormat format):
+    sink_(sink), format_(format)
+{
+}
+
+void EventExporter::write_header()
+{
+    if (format_ == ExportFormat::CSV)
+        put("date,start,end,name,description\n");
+}
+
+void EventExporter::write(const Event& event)
+{
+    if (format_ == ExportFormat::JSON_LINES)
+    {
+        put("{\"date\":\"");
+        put_date(event.date());
+        put("\",\"start\":\"");
+        put_time(event.start());
+        put("\",\"end\":\"");
+        put_time(event.end());
+        put("\",\"name\":");
+        put_json_string(event.name());
+        put(",\"description\":");
+        put_json_string(event.description());
+        put("}\n");
+    }
+    else
+    {
+        put_date(event.date());
+        put(',');
+        put_time(event.start());
+        put(',');
+        put_time(event.end());
+        put(',');
+        put_csv_field(event.name());
+        put(',');
+        put_csv_field(event.description());
+        put('\n');
+    }
+    count_++;
+}
+
+int EventExporter::write_range(const EventRange& events)
+{
+    write_header();
+    int written = 0;
+    for (const Event& event : events)
+    {
+        write(event);
+        written++;
+    }
+    return written;
+}
+
+int EventExporter::count() const
+{
+    return count_;
+}
+
+bool EventExporter::good() const
+{
+    return good_;
+}
+
+void EventExporter::put(string_view text)
+{
+    if (sink_.sputn(text.data(), text.size()) != (streamsize)text.size())
+        good_ = false;
+}
+
+void EventExporter::put(char ch)
+{
+    if (streambuf::traits_type::eq_int_type(sink_.sputc(ch), streambuf::traits_type::eof()))
+        good_ = false;
+}
+
+/* Writes the digits from the end of the buffer towards its beginning. */
+static char* format_number(char* end, int number, int digits)
+{
+    for (int i = 0; i < digits; ++i)
+    {
+        *--end = (char)('0' + number % 10);
+        number /= 10;
+    }
+    return end;
+}
+
+void EventExporter::put_date(const Date& date)
+{
+    char buffer[10];
+    format_number(buffer + 10, date.day(), 2);
+    buffer[7] = '-';
+    format_number(buffer + 7, date.month(), 2);
+    buffer[4] = '-';
+    format_number(buffer + 4, date.year(), 4);
+    put(string_view(buffer, 10));
+}
+
+void EventExporter::put_time(Time::Minutes time)
+{
+    char buffer[5];
+    format_number(buffer + 5, time % 60, 2);
+    buffer[2] = ':';
+    format_number(buffer + 2, time / 60, 2);
+    put(string_view(buffer, 5));
+}
+
+/* Copies runs of plain characters at once and escapes the rest. */
+void EventExporter::put_json_string(string_view text)
+{
+    static const char HEX[] = "0123456789abcdef";
+    put('"');
+    size_t run_start = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        unsigned char ch = (unsigned char)text[i];
+        if (ch >= 0x20 && ch != '"' && ch != '\\')
+            continue;
+
+        put(text.substr(run_start, i - run_start));
+        run_start = i + 1;
+        switch (ch)
+        {
+        case '"': put("\\\""); break;
+        case '\\': put("\\\\"); break;
+        case '\n': put("\\n"); break;
+        case '\r': put("\\r"); break;
+        case '\t': put("\\t"); break;
+        default:
+        {
+            char escape[6] = {'\\', 'u', '0', '0', HEX[ch >> 4], HEX[ch & 0xf]};
+            put(string_view(escape, 6));
+        }
+        }
+    }
+    put(text.substr(run_start));
+    put('"');
+}
+
+/* Quotes the field if it has a separator, quote or line break,
+ * doubling the quotes inside it.
+ */
+void EventExporter::put_csv_field(string_view text)
+{
+    if (text.find_first_of(",\"\r\n") == string_view::npos)
+    {
+        put(text);
+        return;
+    }
+
+    put('"');
+    size_t run_start = 0;
+    size_t quote = text.find('"');
+    while (quote != string_view::npos)
+    {
+        put(text.substr(run_start, quote + 1 - run_start));
+        put('"');
+        run_start = quote + 1;
+        quote = text.find('"', run_start);
+    }
+    put(text.substr(run_start));
+    put('"');
+}
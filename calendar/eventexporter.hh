@@ -0,0 +1,80 @@
+/*
+ * EventExporter writes events as JSON Lines or CSV to any
+ * stream buffer, e.g. a BufferedWriter, the buffer of a file
+ * stream or of a string stream.
+ *
+ * Every field is formatted straight into a small stack buffer
+ * or copied from the event's text, so exporting creates no
+ * temporary strings per event. Texts are escaped as required
+ * by the format (JSON string escapes, RFC 4180 quoting).
+ */
+
+#ifndef EVENTEXPORTER_HH
+#define EVENTEXPORTER_HH
+
+#include "event.hh"
+#include "eventrange.hh"
+
+#include <streambuf>
+#include <string_view>
+
+enum class ExportFormat
+{
+    // one JSON object per line
+    JSON_LINES,
+    // a header line and one row per event
+    CSV
+};
+
+class EventExporter
+{
+public:
+    /**
+     * @brief EventExporter
+     * @param sink where the events are written, must outlive the exporter
+     * @param format format of the output
+     */
+    EventExporter(std::streambuf& sink, ExportFormat format);
+
+    /**
+     * @brief write_header writes the header line of CSV, nothing for JSON Lines
+     */
+    void write_header();
+
+    /**
+     * @brief write writes one event
+     * @param event the event to be written
+     */
+    void write(const Event& event);
+
+    /**
+     * @brief write_range writes the header and every event of the range
+     * @param events the events to be written
+     * @return amount of events written
+     */
+    int write_range(const EventRange& events);
+
+    // amount of events written so far
+    int count() const;
+    // false if the sink did not accept all output
+    bool good() const;
+
+private:
+    std::streambuf& sink_;
+    ExportFormat format_;
+    int count_ = 0;
+    bool good_ = true;
+
+    void put(std::string_view text);
+    void put(char ch);
+    // writes a date as YYYY-MM-DD
+    void put_date(const Date& date);
+    // writes a time as HH:MM
+    void put_time(Time::Minutes time);
+    // writes a text as a quoted and escaped JSON string
+    void put_json_string(std::string_view text);
+    // writes a text as a CSV field, quoted only if needed
+    void put_csv_field(std::string_view text);
+};
+
+#endif // EVENTEXPORTER_HH
@@ -0,0 +1,134 @@
+#include "eventpool.hh"
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+namespace
+{
+
+// a handle has the slot index in its low and the generation in its high bits
+const int GENERATION_SHIFT = 32;
+
+uint32_t slot_index(EventId id)
+{
+    return (uint32_t)id;
+}
+
+uint32_t generation(EventId id)
+{
+    return (uint32_t)(id >> GENERATION_SHIFT);
+}
+
+EventId make_id(uint32_t index, uint32_t generation)
+{
+    return (EventId)generation << GENERATION_SHIFT | index;
+}
+
+}
+
+EventPool::EventPool(uint32_t first_generation):
+    first_generation_(first_generation)
+{
+}
+
+uint32_t EventPool::next_generation() const
+{
+    uint32_t next = first_generation_;
+    for (uint32_t generation : generations_)
+        next = max(next, generation + 1);
+    return next;
+}
+
+EventId EventPool::create(const Date& date, string_view name, Time::Minutes start,
+                          Time::Minutes end, string_view description)
+{
+    Event event(date, strings_.intern(name), start, end, strings_.intern(description));
+    if (!free_slots_.empty())
+    {
+        uint32_t index = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[index] = event;
+        released_[index] = false;
+        return make_id(index, generations_[index]);
+    }
+
+    slots_.push_back(event);
+    generations_.push_back(first_generation_);
+    released_.push_back(false);
+    return make_id(slots_.size() - 1, first_generation_);
+}
+
+void EventPool::release(EventId id)
+{
+    if (!contains(id))
+        return;
+
+    released_[slot_index(id)] = true;
+    released_count_++;
+}
+
+bool EventPool::restore(EventId id)
+{
+    if (!is_current(id) || !released_[slot_index(id)])
+        return false;
+
+    released_[slot_index(id)] = false;
+    released_count_--;
+    return true;
+}
+
+/* A new generation makes the old handles of the slot invalid.
+ * The texts of the event lose a user.
+ */
+void EventPool::reclaim(EventId id)
+{
+    if (!is_current(id) || !released_[slot_index(id)])
+        return;
+
+    const Event& event = slots_[slot_index(id)];
+    strings_.release(&event.name());
+    strings_.release(&event.description());
+    generations_[slot_index(id)]++;
+    released_count_--;
+    free_slots_.push_back(slot_index(id));
+}
+
+bool EventPool::is_current(EventId id) const
+{
+    return slot_index(id) < slots_.size() &&
+           generations_[slot_index(id)] == generation(id);
+}
+
+bool EventPool::contains(EventId id) const
+{
+    return is_current(id) && !released_[slot_index(id)];
+}
+
+Event& EventPool::get(EventId id)
+{
+    assert(is_current(id));
+    return slots_[slot_index(id)];
+}
+
+const Event& EventPool::get(EventId id) const
+{
+    assert(is_current(id));
+    return slots_[slot_index(id)];
+}
+
+int EventPool::size() const
+{
+    return (int)(slots_.size() - free_slots_.size()) - released_count_;
+}
+
+size_t EventPool::event_bytes() const
+{
+    return slots_.size() * sizeof(Event) + generations_.capacity() * sizeof(uint32_t) +
+           released_.capacity() / 8 + free_slots_.capacity() * sizeof(uint32_t);
+}
+
+const StringPool& EventPool::strings() const
+{
+    return strings_;
+}
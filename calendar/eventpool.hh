@@ -0,0 +1,118 @@
+/*
+ * EventPool owns all events of a calendar. Events are kept in
+ * large blocks of memory instead of each event being its own
+ * heap allocation, and they are addressed with small integer
+ * handles (EventId). A handle is the index of the slot and the
+ * generation of the slot, which grows each time the slot is
+ * reused, so a handle of a deleted event never points to
+ * another event. A released event keeps its slot, so it can be
+ * restored (undo), until the slot is reclaimed for new events.
+ *
+ * Names and descriptions are interned to a StringPool, so
+ * events with the same texts share them.
+ */
+
+#ifndef EVENTPOOL_HH
+#define EVENTPOOL_HH
+
+#include "event.hh"
+#include "stringpool.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+class EventPool
+{
+public:
+    /**
+     * @brief EventPool
+     * @param first_generation generation of new slots, a pool that
+     * replaces another starts from its next_generation()
+     */
+    explicit EventPool(std::uint32_t first_generation = 0);
+
+    /**
+     * @brief next_generation
+     * @return a generation above that of every handle of this pool
+     */
+    std::uint32_t next_generation() const;
+
+    /**
+     * @brief create stores a new event
+     * @return handle of the event
+     */
+    EventId create(const Date& date, std::string_view name, Time::Minutes start,
+                   Time::Minutes end, std::string_view description);
+
+    /**
+     * @brief release marks the event deleted
+     * @param id handle of the event, not valid after this
+     */
+    void release(EventId id);
+
+    /**
+     * @brief restore brings a released event back with the same handle
+     * @param id handle of a released event
+     * @return false if the event was not released
+     */
+    bool restore(EventId id);
+
+    /**
+     * @brief reclaim frees the slot of a released event for new events,
+     * and its texts if no other event uses them
+     * @param id handle of a released event, it can not be restored after this
+     */
+    void reclaim(EventId id);
+
+    /**
+     * @brief contains
+     * @param id handle of an event
+     * @return true if the handle is of an event that is not released
+     */
+    bool contains(EventId id) const;
+
+    /**
+     * @brief get a getter function
+     * @param id handle of the event, current or released but not reclaimed
+     * @return the event
+     */
+    Event& get(EventId id);
+    const Event& get(EventId id) const;
+
+    /**
+     * @brief size
+     * @return amount of events currently stored
+     */
+    int size() const;
+
+    /**
+     * @brief event_bytes
+     * @return memory used by event slots in bytes
+     */
+    std::size_t event_bytes() const;
+
+    const StringPool& strings() const;
+
+private:
+    // deque allocates slots in blocks and never moves them
+    std::deque<Event> slots_;
+    // generation of each slot, part of the handles of its events
+    std::vector<std::uint32_t> generations_;
+    // true for slots of released events
+    std::vector<bool> released_;
+    // released slots that are not yet reclaimed
+    int released_count_ = 0;
+    // reclaimed slots, reused by create()
+    std::vector<std::uint32_t> free_slots_;
+    // generation of slots added to the pool
+    std::uint32_t first_generation_;
+    StringPool strings_;
+
+    // true if the handle is of the current generation of its slot
+    bool is_current(EventId id) const;
+};
+
+#endif // EVENTPOOL_HH
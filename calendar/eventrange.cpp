@@ -0,0 +1,84 @@
+#include "eventrange.hh"
+
+EventRange::iterator::iterator(DayIterator day, DayIterator last_day,
+                               const EventPool* pool):
+    day_(day), last_day_(last_day), pool_(pool)
+{
+    skip_empty_days();
+}
+
+const Event& EventRange::iterator::operator*() const
+{
+    return pool_->get(id());
+}
+
+const Event* EventRange::iterator::operator->() const
+{
+    return &pool_->get(id());
+}
+
+EventId EventRange::iterator::id() const
+{
+    return day_->second.at(index_).id;
+}
+
+EventRange::iterator& EventRange::iterator::operator++()
+{
+    index_++;
+    if (index_ >= day_->second.size())
+    {
+        ++day_;
+        index_ = 0;
+        skip_empty_days();
+    }
+    return *this;
+}
+
+bool EventRange::iterator::operator==(const iterator& other) const
+{
+    return day_ == other.day_ && index_ == other.index_;
+}
+
+bool EventRange::iterator::operator!=(const iterator& other) const
+{
+    return !(*this == other);
+}
+
+void EventRange::iterator::skip_empty_days()
+{
+    while (day_ != last_day_ && day_->second.empty())
+    {
+        ++day_;
+    }
+}
+
+EventRange::EventRange(DayIterator first_day, DayIterator last_day,
+                       const EventPool* pool):
+    first_day_(first_day), last_day_(last_day), pool_(pool)
+{
+}
+
+EventRange::iterator EventRange::begin() const
+{
+    return iterator(first_day_, last_day_, pool_);
+}
+
+EventRange::iterator EventRange::end() const
+{
+    return iterator(last_day_, last_day_, pool_);
+}
+
+int EventRange::size() const
+{
+    int amount = 0;
+    for (DayIterator day = first_day_; day != last_day_; ++day)
+    {
+        amount += day->second.size();
+    }
+    return amount;
+}
+
+bool EventRange::empty() const
+{
+    return begin() == end();
+}
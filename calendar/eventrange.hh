@@ -0,0 +1,71 @@
+/*
+ * EventRange is a lightweight view over the events of
+ * consecutive days in a Calendar. It does not copy any
+ * events, iterating it walks the stored days in date order
+ * and the events of each day in time order.
+ *
+ * The view is valid until the calendar is modified or
+ * another range of it is queried.
+ */
+
+#ifndef EVENTRANGE_HH
+#define EVENTRANGE_HH
+
+#include "dayevents.hh"
+#include "eventpool.hh"
+
+#include <map>
+
+class EventRange
+{
+public:
+    using DayIterator = std::map<int, DayEvents>::const_iterator;
+
+    class iterator
+    {
+    public:
+        iterator(DayIterator day, DayIterator last_day, const EventPool* pool);
+
+        const Event& operator*() const;
+        const Event* operator->() const;
+        // handle of the current event
+        EventId id() const;
+        iterator& operator++();
+        bool operator==(const iterator& other) const;
+        bool operator!=(const iterator& other) const;
+
+    private:
+        // moves to the next day that has events
+        void skip_empty_days();
+
+        DayIterator day_;
+        DayIterator last_day_;
+        const EventPool* pool_;
+        int index_ = 0;
+    };
+
+    /**
+     * @brief EventRange
+     * @param first_day first day of the range
+     * @param last_day one past the last day of the range
+     * @param pool pool where the events are stored
+     */
+    EventRange(DayIterator first_day, DayIterator last_day, const EventPool* pool);
+
+    iterator begin() const;
+    iterator end() const;
+
+    /**
+     * @brief size
+     * @return amount of events in the range
+     */
+    int size() const;
+    bool empty() const;
+
+private:
+    DayIterator first_day_;
+    DayIterator last_day_;
+    const EventPool* pool_;
+};
+
+#endif // EVENTRANGE_HH
@@ -0,0 +1,103 @@
+#include "freebusy.hh"
+#include "dayordinal.hh"
+#include <algorithm>
+#include <queue>
+#include <thread>
+
+using namespace std;
+
+/* Events come ordered by date and start time, so overlapping and
+ * touching events are merged by extending the last interval.
+ */
+vector<TimeInterval> busy_intervals(Calendar& calendar, Date from, Date to)
+{
+    vector<TimeInterval> busy;
+    for (const Event& event : calendar.events_in_range(from, to))
+    {
+        int ordinal = day_ordinal(event.date());
+        TimeInterval interval{to_instant(ordinal, event.start()),
+                              to_instant(ordinal, event.end())};
+        if (!busy.empty() && interval.start <= busy.back().end)
+            busy.back().end = max(busy.back().end, interval.end);
+        else
+            busy.push_back(interval);
+    }
+    return busy;
+}
+
+/* Takes the earliest interval of all lists with a heap of list heads. */
+vector<TimeInterval> merge_busy(const vector<vector<TimeInterval>>& busy)
+{
+    // (start of the head interval, list, index in the list)
+    using Head = pair<Instant, pair<size_t, size_t>>;
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+    size_t total = 0;
+    for (size_t list = 0; list < busy.size(); ++list)
+    {
+        if (!busy.at(list).empty())
+            heads.push({busy.at(list).front().start, {list, 0}});
+        total += busy.at(list).size();
+    }
+
+    vector<TimeInterval> merged;
+    merged.reserve(min<size_t>(total, 1 << 16));
+    while (!heads.empty())
+    {
+        size_t list = heads.top().second.first;
+        size_t index = heads.top().second.second;
+        heads.pop();
+
+        const TimeInterval& interval = busy.at(list).at(index);
+        if (!merged.empty() && interval.start <= merged.back().end)
+            merged.back().end = max(merged.back().end, interval.end);
+        else
+            merged.push_back(interval);
+
+        if (index + 1 < busy.at(list).size())
+            heads.push({busy.at(list).at(index + 1).start, {list, index + 1}});
+    }
+    return merged;
+}
+
+/* Each thread handles every threads:th calendar, and the merged
+ * busy times of the threads are merged once more.
+ */
+vector<TimeInterval> common_free_slots(const vector<Calendar*>& calendars,
+                                       Date from, Date to,
+                                       Time::Minutes min_length, int threads)
+{
+    if (threads <= 0)
+        threads = max(1u, thread::hardware_concurrency());
+    threads = max(1, min(threads, (int)calendars.size()));
+
+    vector<vector<TimeInterval>> group_busy(threads);
+    auto merge_group = [&](int group)
+    {
+        vector<vector<TimeInterval>> busy;
+        for (size_t i = group; i < calendars.size(); i += threads)
+            busy.push_back(busy_intervals(*calendars.at(i), from, to));
+        group_busy.at(group) = merge_busy(busy);
+    };
+
+    vector<thread> workers;
+    for (int group = 1; group < threads; ++group)
+        workers.emplace_back(merge_group, group);
+    merge_group(0);
+    for (thread& worker : workers)
+        worker.join();
+
+    // free time is what is left between the busy intervals
+    vector<TimeInterval> free_slots;
+    Instant free_from = to_instant(day_ordinal(from), 0);
+    Instant range_end = to_instant(day_ordinal(to) + 1, 0);
+    vector<TimeInterval> busy = merge_busy(group_busy);
+    busy.push_back({range_end, range_end});
+    for (const TimeInterval& interval : busy)
+    {
+        // a free slot is never empty, whatever the min_length
+        if (interval.start > free_from && interval.start - free_from >= min_length)
+            free_slots.push_back({free_from, interval.start});
+        free_from = max(free_from, interval.end);
+    }
+    return free_slots;
+}
@@ -0,0 +1,59 @@
+/*
+ * Free/busy queries over many calendars. Each calendar gives
+ * its busy time of a date range as merged, ordered intervals,
+ * and the intervals of all calendars are combined with a k-way
+ * merge, so every calendar is read only once and the result is
+ * built in one pass. With many calendars the work is split
+ * over threads: each thread reads and merges its own group of
+ * calendars and the groups are merged at the end.
+ *
+ * A Calendar itself is not thread-safe, a calendar must not
+ * be changed while a query reads it.
+ */
+
+#ifndef FREEBUSY_HH
+#define FREEBUSY_HH
+
+#include "calendar.hh"
+#include "reminderqueue.hh"
+
+#include <vector>
+
+// a time range [start, end) in minutes since 1.1.1970
+struct TimeInterval
+{
+    Instant start;
+    Instant end;
+};
+
+/**
+ * @brief busy_intervals gives the busy time of a calendar
+ * @param calendar the calendar to read
+ * @param from first date of the range
+ * @param to last date of the range (included)
+ * @return busy time as ordered intervals that do not overlap or touch
+ */
+std::vector<TimeInterval> busy_intervals(Calendar& calendar, Date from, Date to);
+
+/**
+ * @brief merge_busy combines busy times with a k-way merge
+ * @param busy ordered, non-overlapping intervals of each calendar
+ * @return the union of the intervals, ordered and non-overlapping
+ */
+std::vector<TimeInterval> merge_busy(const std::vector<std::vector<TimeInterval>>& busy);
+
+/**
+ * @brief common_free_slots finds the times when every calendar is free
+ * @param calendars the calendars, each one is read by a single thread
+ * @param from first date of the range
+ * @param to last date of the range (included)
+ * @param min_length shortest free time to be returned, in minutes.
+ * Empty slots are never returned, even if it is 0 or less.
+ * @param threads amount of threads to use, 0 for the amount of cores
+ * @return free slots ordered by time
+ */
+std::vector<TimeInterval> common_free_slots(const std::vector<Calendar*>& calendars,
+                                            Date from, Date to,
+                                            Time::Minutes min_length, int threads = 0);
+
+#endif // FREEBUSY_HH
@@ -0,0 +1,137 @@
+#include "history.hh"
+
+using namespace std;
+
+History::History(size_t budget_bytes):
+    budget_entries_(budget_bytes / sizeof(HistoryEntry))
+{
+}
+
+void History::set_drop_handler(function<void(EventId)> handler)
+{
+    drop_handler_ = std::move(handler);
+}
+
+/* Only the outermost group starts a new step. */
+void History::begin_group()
+{
+    if (group_depth_++ == 0)
+        group_started_ = false;
+}
+
+void History::end_group()
+{
+    if (group_depth_ > 0)
+        group_depth_--;
+}
+
+/* A new change makes the undone changes impossible to redo. */
+void History::record(HistoryAction action, EventId id, int ordinal)
+{
+    bool group_start = group_depth_ == 0 || !group_started_;
+    if (group_depth_ > 0)
+        group_started_ = true;
+
+    drop_all(redo_);
+    undo_.push_back({id, ordinal, action, group_start});
+    enforce_budget();
+}
+
+vector<HistoryEntry> History::take_undo()
+{
+    return take_group(undo_);
+}
+
+vector<HistoryEntry> History::take_redo()
+{
+    return take_group(redo_);
+}
+
+void History::push_undo(const vector<HistoryEntry>& group)
+{
+    push_group(undo_, group);
+    enforce_budget();
+}
+
+void History::push_redo(const vector<HistoryEntry>& group)
+{
+    push_group(redo_, group);
+    enforce_budget();
+}
+
+/* Takes entries from the top of the stack down to the group start. */
+vector<HistoryEntry> History::take_group(deque<HistoryEntry>& stack)
+{
+    vector<HistoryEntry> group;
+    while (!stack.empty())
+    {
+        group.push_back(stack.back());
+        stack.pop_back();
+        if (group.back().group_start)
+            break;
+    }
+    // back to the recording order
+    return vector<HistoryEntry>(group.rbegin(), group.rend());
+}
+
+void History::push_group(deque<HistoryEntry>& stack, const vector<HistoryEntry>& group)
+{
+    for (size_t i = 0; i < group.size(); ++i)
+    {
+        HistoryEntry entry = group.at(i);
+        entry.group_start = i == 0;
+        stack.push_back(entry);
+    }
+}
+
+/* A dropped RESTORE entry was the last way back to its event. */
+void History::drop(const HistoryEntry& entry)
+{
+    if (entry.action == HistoryAction::RESTORE && drop_handler_)
+        drop_handler_(entry.id);
+}
+
+void History::drop_all(deque<HistoryEntry>& stack)
+{
+    for (const HistoryEntry& entry : stack)
+    {
+        drop(entry);
+    }
+    stack.clear();
+}
+
+/* The oldest groups are at the bottom of the undo stack, and of the
+ * redo stack when the undo stack is empty.
+ */
+void History::enforce_budget()
+{
+    while (undo_.size() + redo_.size() > budget_entries_)
+    {
+        deque<HistoryEntry>& oldest = undo_.empty() ? redo_ : undo_;
+        // a whole group goes, a half group could not be undone
+        do
+        {
+            drop(oldest.front());
+            oldest.pop_front();
+        }
+        while (!oldest.empty() && !oldest.front().group_start);
+    }
+}
+
+void History::set_budget(size_t budget_bytes)
+{
+    budget_entries_ = budget_bytes / sizeof(HistoryEntry);
+    enforce_budget();
+}
+
+size_t History::bytes() const
+{
+    return (undo_.size() + redo_.size()) * sizeof(HistoryEntry);
+}
+
+void History::clear()
+{
+    drop_all(undo_);
+    drop_all(redo_);
+    group_depth_ = 0;
+}
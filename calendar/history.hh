@@ -0,0 +1,120 @@
+/*
+ * History keeps the undo and redo stacks of a calendar. Each
+ * change is stored as its inverse operation in 16 bytes: the
+ * handle of the event and, for moves, the day it came from.
+ * Deleted events stay in the event pool (see eventpool.hh), so
+ * an undone delete only needs the handle.
+ *
+ * Operations done together (e.g. a batch delete) form a group
+ * that is undone and redone as one step. Groups may be nested,
+ * the outermost group is the step.
+ *
+ * The stacks stay within a memory budget, the oldest groups
+ * are dropped when it is exceeded. The budget covers the
+ * entries only. Each RESTORE entry also keeps the slot of its
+ * deleted event in the pool, so at most budget / 16 slots are
+ * kept. When a RESTORE entry is dropped, its event can not come
+ * back, and the drop handler is called so the slot can be
+ * reclaimed.
+ */
+
+#ifndef HISTORY_HH
+#define HISTORY_HH
+
+#include "event.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+enum class HistoryAction : std::uint8_t
+{
+    // delete the event
+    REMOVE = 1,
+    // bring back a deleted event
+    RESTORE = 2,
+    // move the event to the day
+    MOVE_TO = 3
+};
+
+struct HistoryEntry
+{
+    EventId id;
+    // day ordinal for MOVE_TO
+    int ordinal;
+    HistoryAction action;
+    // true for the first entry of a group
+    bool group_start;
+};
+
+class History
+{
+public:
+    /**
+     * @brief History
+     * @param budget_bytes most memory the undo and redo stacks may use
+     */
+    explicit History(std::size_t budget_bytes = 1 << 20);
+
+    /**
+     * @brief set_drop_handler
+     * @param handler called with the handle of the deleted event of
+     * each RESTORE entry that is dropped without being applied
+     */
+    void set_drop_handler(std::function<void(EventId)> handler);
+
+    /**
+     * @brief begin_group makes the entries recorded until the matching
+     * end_group() one group. Outside a group every entry is a group of
+     * its own. A group begun inside another one is part of it.
+     */
+    void begin_group();
+    void end_group();
+
+    /**
+     * @brief record adds the inverse of a change to the undo stack
+     * and empties the redo stack
+     */
+    void record(HistoryAction action, EventId id, int ordinal = 0);
+
+    /**
+     * @brief take_undo removes the latest group from the undo stack
+     * @return entries of the group in the order they were recorded,
+     * empty if there is nothing to undo
+     */
+    std::vector<HistoryEntry> take_undo();
+    std::vector<HistoryEntry> take_redo();
+
+    // adds a group of inverse operations to the stack
+    void push_undo(const std::vector<HistoryEntry>& group);
+    void push_redo(const std::vector<HistoryEntry>& group);
+
+    void set_budget(std::size_t budget_bytes);
+    // memory used by the entries, not by the event slots they keep
+    std::size_t bytes() const;
+    void clear();
+
+private:
+    std::deque<HistoryEntry> undo_;
+    std::deque<HistoryEntry> redo_;
+    std::size_t budget_entries_;
+    // amount of begin_group() calls without their end_group()
+    int group_depth_ = 0;
+    // true after the first entry of the open group
+    bool group_started_ = false;
+    std::function<void(EventId)> drop_handler_;
+
+    static std::vector<HistoryEntry> take_group(std::deque<HistoryEntry>& stack);
+    static void push_group(std::deque<HistoryEntry>& stack,
+                           const std::vector<HistoryEntry>& group);
+    // forgets an entry that is not applied
+    void drop(const HistoryEntry& entry);
+    // drops every entry of the stack
+    void drop_all(std::deque<HistoryEntry>& stack);
+    // drops the oldest groups until the stacks fit the budget
+    void enforce_budget();
+};
+
+#endif // HISTORY_HH
@@ -0,0 +1,312 @@
+#include "icsimporter.hh"
+#include "dayordinal.hh"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+// size of the read buffer of the input file
+const int READ_BUFFER_SIZE = 1 << 20;
+
+double IcsImportResult::events_per_second() const
+{
+    if (seconds <= 0)
+        return 0;
+    return imported / seconds;
+}
+
+IcsImporter::IcsImporter(Calendar& calendar):
+    calendar_(calendar)
+{
+}
+
+/* Removes the trailing '\r' of a line ending with CRLF. */
+static string_view strip_cr(string_view line)
+{
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return line;
+}
+
+/* Reads a number of exactly length digits, returns -1 if not a number. */
+static int parse_digits(string_view text, size_t position, size_t length)
+{
+    if (text.size() < position + length)
+        return -1;
+
+    int number = 0;
+    for (size_t i = position; i < position + length; ++i)
+    {
+        if (text[i] < '0' || text[i] > '9')
+            return -1;
+        number = number * 10 + (text[i] - '0');
+    }
+    return number;
+}
+
+/* Reverses the escaping of iCalendar TEXT values. */
+static string unescape_text(string_view value)
+{
+    string text;
+    text.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        if (value[i] == '\\' && i + 1 < value.size())
+        {
+            ++i;
+            text += (value[i] == 'n' || value[i] == 'N') ? '\n' : value[i];
+        }
+        else
+        {
+            text += value[i];
+        }
+    }
+    return text;
+}
+
+/* Reads the whole file and adds the found events in one batch.
+ * Folded lines (continuation lines starting with a space or a tab)
+ * are joined before they are handled. A content line is kept in the
+ * buffer until the next line shows that it is not folded, so lines
+ * are only copied when they really are folded.
+ */
+IcsImportResult IcsImporter::import_file(const string& file_name)
+{
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    result_ = IcsImportResult();
+    events_.clear();
+    in_event_ = false;
+
+    ifstream file(file_name, ios::binary);
+    if (!file)
+        return result_;
+    result_.file_found = true;
+
+    vector<char> buffer(READ_BUFFER_SIZE);
+    // bytes read to the buffer and the start of the next line in it
+    size_t filled = 0;
+    size_t position = 0;
+    bool end_of_file = false;
+
+    // the content line waiting for its continuation lines: a part of
+    // the buffer, or a copy if it was folded
+    bool has_pending = false;
+    bool folded = false;
+    size_t pending_start = 0;
+    size_t pending_size = 0;
+    string folded_line;
+    int pending_line_number = 0;
+
+    int line_number = 0;
+    while (true)
+    {
+        char* newline = static_cast<char*>(
+            memchr(buffer.data() + position, '\n', filled - position));
+        if (newline == nullptr && !end_of_file)
+        {
+            // keep the unfinished lines and read more after them
+            size_t keep = has_pending && !folded ? pending_start : position;
+            memmove(buffer.data(), buffer.data() + keep, filled - keep);
+            filled -= keep;
+            position -= keep;
+            pending_start -= has_pending && !folded ? keep : 0;
+            if (filled == buffer.size())
+                buffer.resize(buffer.size() * 2);
+
+            file.read(buffer.data() + filled, buffer.size() - filled);
+            filled += file.gcount();
+            end_of_file = file.gcount() == 0;
+            continue;
+        }
+        if (position == filled)
+            break;
+
+        size_t line_end = newline != nullptr ? newline - buffer.data() : filled;
+        string_view current = strip_cr(
+            string_view(buffer.data() + position, line_end - position));
+        line_number++;
+        position = newline != nullptr ? line_end + 1 : filled;
+
+        // continuation of the previous line
+        if (!current.empty() && (current.front() == ' ' || current.front() == '\t'))
+        {
+            if (!has_pending)
+                continue;
+            if (!folded)
+                folded_line.assign(buffer.data() + pending_start, pending_size);
+            folded = true;
+            folded_line.append(current.data() + 1, current.size() - 1);
+            continue;
+        }
+
+        if (has_pending)
+            handle_line(folded ? string_view(folded_line)
+                               : string_view(buffer.data() + pending_start, pending_size),
+                        pending_line_number);
+
+        has_pending = true;
+        folded = false;
+        pending_start = current.data() - buffer.data();
+        pending_size = current.size();
+        pending_line_number = line_number;
+    }
+    if (has_pending)
+        handle_line(folded ? string_view(folded_line)
+                           : string_view(buffer.data() + pending_start, pending_size),
+                    pending_line_number);
+
+    if (in_event_)
+    {
+        result_.errors.push_back({event_line_, "VEVENT is missing END:VEVENT"});
+        result_.skipped++;
+    }
+
+    result_.imported = calendar_.add_events(std::move(events_));
+    events_.clear();
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    result_.seconds = elapsed.count();
+    return result_;
+}
+
+/* Splits a content line to name and value and updates the event state. */
+void IcsImporter::handle_line(string_view line, int line_number)
+{
+    if (line.empty())
+        return;
+
+    size_t colon = line.find(':');
+    if (colon == string_view::npos)
+    {
+        if (in_event_)
+            result_.errors.push_back({line_number, "line has no ':'"});
+        return;
+    }
+
+    string_view name = line.substr(0, colon);
+    string_view value = line.substr(colon + 1);
+    // parameters like ;TZID=... are not needed
+    name = name.substr(0, name.find(';'));
+
+    if (name == "BEGIN" && value == "VEVENT")
+    {
+        // events cannot be nested, so the earlier one was not terminated
+        if (in_event_)
+        {
+            result_.errors.push_back({event_line_, "VEVENT is missing END:VEVENT"});
+            result_.skipped++;
+        }
+        in_event_ = true;
+        event_line_ = line_number;
+        component_depth_ = 0;
+        has_start_ = false;
+        has_end_ = false;
+        summary_.clear();
+        description_.clear();
+        return;
+    }
+    if (!in_event_)
+        return;
+
+    if (name == "BEGIN")
+    {
+        component_depth_++;
+    }
+    else if (name == "END" && component_depth_ > 0)
+    {
+        component_depth_--;
+    }
+    else if (name == "END")
+    {
+        if (value == "VEVENT")
+            finish_event(line_number);
+        else
+        {
+            result_.errors.push_back({event_line_, "VEVENT is missing END:VEVENT"});
+            result_.skipped++;
+        }
+        in_event_ = false;
+    }
+    // the properties of components inside the event are not its own
+    else if (component_depth_ > 0)
+    {
+        return;
+    }
+    else if (name == "DTSTART")
+    {
+        has_start_ = parse_date_time(value, start_date_, start_time_, start_has_time_);
+        if (!has_start_)
+            result_.errors.push_back({line_number, "malformed DTSTART"});
+    }
+    else if (name == "DTEND")
+    {
+        has_end_ = parse_date_time(value, end_date_, end_time_, end_has_time_);
+        if (!has_end_)
+            result_.errors.push_back({line_number, "malformed DTEND"});
+    }
+    else if (name == "SUMMARY")
+    {
+        summary_ = unescape_text(value);
+    }
+    else if (name == "DESCRIPTION")
+    {
+        description_ = unescape_text(value);
+    }
+}
+
+/* Reads values of form YYYYMMDD or YYYYMMDDTHHMMSS[Z]. */
+bool IcsImporter::parse_date_time(string_view value, Date& date,
+                                  Time::Minutes& time, bool& has_time)
+{
+    int year = parse_digits(value, 0, 4);
+    int month = parse_digits(value, 4, 2);
+    int day = parse_digits(value, 6, 2);
+    if (year < 0 || month < 0 || day < 0 || !Date::is_valid_date(day, month, year))
+        return false;
+    date = Date(day, month, year);
+
+    has_time = value.size() > 8;
+    if (!has_time)
+    {
+        time = 0;
+        return value.size() == 8;
+    }
+
+    int hours = parse_digits(value, 9, 2);
+    int minutes = parse_digits(value, 11, 2);
+    if (value[8] != 'T' || hours < 0 || minutes < 0)
+        return false;
+
+    time = hours * 60 + minutes;
+    return Time::is_valid(time);
+}
+
+/* Creates the event that was read. The calendar only has events within
+ * a single day, so events continuing past midnight end at DAY_END.
+ */
+void IcsImporter::finish_event(int line_number)
+{
+    if (!has_start_)
+    {
+        result_.errors.push_back({event_line_, "VEVENT has no valid DTSTART"});
+        result_.skipped++;
+        return;
+    }
+
+    Time::Minutes start = start_has_time_ ? start_time_ : 0;
+    Time::Minutes end = DAY_END;
+    if (has_end_ && end_has_time_ && day_ordinal(end_date_) == day_ordinal(start_date_))
+        end = end_time_;
+    else if (has_end_ && day_ordinal(end_date_) < day_ordinal(start_date_))
+        end = start;
+
+    if (start >= end)
+    {
+        result_.errors.push_back({line_number, "VEVENT ends before it starts"});
+        result_.skipped++;
+        return;
+    }
+
+    events_.push_back({start_date_, summary_, start, end, description_});
+}
@@ -0,0 +1,93 @@
+/*
+ * IcsImporter reads events from an iCalendar (.ics) file
+ * and adds them to a Calendar in a single batch.
+ *
+ * The file is read in large chunks and each content line is
+ * handled as a string_view into the read buffer. Only folded
+ * lines are joined to a copy, and only the final event texts
+ * are copied. Only the VEVENT properties the calendar can
+ * store are read (DTSTART, DTEND, SUMMARY, DESCRIPTION),
+ * other components and properties are skipped, also the ones
+ * inside the VEVENT (like VALARM).
+ */
+
+#ifndef ICSIMPORTER_HH
+#define ICSIMPORTER_HH
+
+#include "calendar.hh"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct IcsError
+{
+    // line where the faulty property or event started
+    int line;
+    std::string message;
+};
+
+struct IcsImportResult
+{
+    // false if the file could not be opened
+    bool file_found = false;
+    int imported = 0;
+    int skipped = 0;
+    double seconds = 0;
+    std::vector<IcsError> errors;
+
+    /**
+     * @brief events_per_second
+     * @return import throughput
+     */
+    double events_per_second() const;
+};
+
+class IcsImporter
+{
+public:
+    /**
+     * @brief IcsImporter
+     * @param calendar the calendar where the events are added
+     */
+    IcsImporter(Calendar& calendar);
+
+    /**
+     * @brief import_file reads all events of the file. Every affected
+     * day of the calendar is sorted once after the whole file is read.
+     * @param file_name path of the .ics file
+     * @return counts, errors and throughput of the import
+     */
+    IcsImportResult import_file(const std::string& file_name);
+
+private:
+    // handles one unfolded content line
+    void handle_line(std::string_view line, int line_number);
+    // creates the event that was just read, if it is valid
+    void finish_event(int line_number);
+    // reads a DTSTART/DTEND value, returns false if malformed
+    bool parse_date_time(std::string_view value, Date& date,
+                         Time::Minutes& time, bool& has_time);
+
+    Calendar& calendar_;
+    IcsImportResult result_;
+    std::vector<EventData> events_;
+
+    // state of the VEVENT being read
+    bool in_event_ = false;
+    int event_line_ = 0;
+    // depth of the components (like VALARM) inside the VEVENT
+    int component_depth_ = 0;
+    bool has_start_ = false;
+    bool has_end_ = false;
+    bool start_has_time_ = false;
+    bool end_has_time_ = false;
+    Date start_date_;
+    Date end_date_;
+    Time::Minutes start_time_ = 0;
+    Time::Minutes end_time_ = 0;
+    std::string summary_;
+    std::string description_;
+};
+
+#endif // ICSIMPORTER_HH
@@ -0,0 +1,320 @@
+#include "journal.hh"
+#include "dayordinal.hh"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+// record frame: payload length, checksum of payload, payload
+const size_t FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+/* FNV-1a hash, good enough to notice a torn or garbled record. */
+uint32_t checksum(const char* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void put_int(string& buffer, int32_t value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_string(string& buffer, const string& text)
+{
+    put_int(buffer, (int32_t)text.size());
+    buffer += text;
+}
+
+/* Reads values from a record payload, fails when running out of data. */
+class PayloadReader
+{
+public:
+    PayloadReader(const char* data, size_t size): data_(data), size_(size) {}
+
+    bool get_int(int32_t& value)
+    {
+        if (size_ - position_ < sizeof(value))
+            return false;
+        memcpy(&value, data_ + position_, sizeof(value));
+        position_ += sizeof(value);
+        return true;
+    }
+
+    bool get_string(string& text)
+    {
+        int32_t length = 0;
+        if (!get_int(length) || length < 0 || size_ - position_ < (size_t)length)
+            return false;
+        text.assign(data_ + position_, length);
+        position_ += length;
+        return true;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t position_ = 0;
+};
+
+/* Decodes a record payload, returns false if it is malformed. */
+bool decode(const char* data, size_t size, JournalRecord& record)
+{
+    if (size < 1)
+        return false;
+
+    record.type = (JournalRecordType)data[0];
+    PayloadReader reader(data + 1, size - 1);
+    int32_t start = 0;
+    int32_t end = 0;
+    switch (record.type)
+    {
+    case JournalRecordType::ADD:
+        if (!reader.get_int(record.ordinal) || !reader.get_int(start) ||
+            !reader.get_int(end) || !reader.get_string(record.name) ||
+            !reader.get_string(record.description))
+            return false;
+        record.start = start;
+        record.end = end;
+        return true;
+    case JournalRecordType::DELETE:
+        return reader.get_int(record.ordinal) && reader.get_int(record.index);
+    case JournalRecordType::MOVE:
+        return reader.get_int(record.ordinal) && reader.get_int(record.index) &&
+               reader.get_int(record.new_ordinal);
+    case JournalRecordType::CHANGE_DATE:
+    case JournalRecordType::EPOCH:
+        return reader.get_int(record.ordinal);
+    case JournalRecordType::SERIES:
+    {
+        int32_t frequency = 0;
+        int32_t has_until = 0;
+        int32_t until = 0;
+        if (!reader.get_int(record.ordinal) || !reader.get_int(start) ||
+            !reader.get_int(end) || !reader.get_string(record.name) ||
+            !reader.get_string(record.description) || !reader.get_int(frequency) ||
+            !reader.get_int(record.rule.interval) || !reader.get_int(record.rule.count) ||
+            !reader.get_int(has_until) || !reader.get_int(until))
+            return false;
+        record.start = start;
+        record.end = end;
+        record.rule.frequency = (Frequency)frequency;
+        record.rule.has_until = has_until != 0;
+        if (record.rule.has_until)
+            record.rule.until = date_from_ordinal(until);
+        return true;
+    }
+    case JournalRecordType::EXCEPTION:
+        return reader.get_int(record.ordinal) && reader.get_int(record.index);
+    }
+    return false;
+}
+}
+
+Journal::Journal(int group_size, int max_delay_ms):
+    group_size_(group_size),
+    max_delay_(max_delay_ms)
+{
+    if (max_delay_ms > 0)
+        flusher_ = thread(&Journal::flush_late_groups, this);
+}
+
+Journal::~Journal()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    group_waiting_.notify_one();
+    if (flusher_.joinable())
+        flusher_.join();
+
+    sync();
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+/* Sleeps until the first record of a group has waited long enough.
+ * A group synced in the meantime (full or by sync()) is not synced again.
+ */
+void Journal::flush_late_groups()
+{
+    unique_lock<mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        if (buffer_.empty())
+        {
+            group_waiting_.wait(lock);
+            continue;
+        }
+        chrono::steady_clock::time_point deadline = group_started_ + max_delay_;
+        if (chrono::steady_clock::now() >= deadline)
+            sync_locked();
+        else
+            group_waiting_.wait_until(lock, deadline);
+    }
+}
+
+bool Journal::open(const string& file_name)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (fd_ >= 0)
+        ::close(fd_);
+
+    fd_ = ::open(file_name.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    return fd_ >= 0;
+}
+
+void Journal::append(const JournalRecord& record)
+{
+    string payload;
+    payload += (char)record.type;
+    put_int(payload, record.ordinal);
+    switch (record.type)
+    {
+    case JournalRecordType::ADD:
+        put_int(payload, record.start);
+        put_int(payload, record.end);
+        put_string(payload, record.name);
+        put_string(payload, record.description);
+        break;
+    case JournalRecordType::DELETE:
+        put_int(payload, record.index);
+        break;
+    case JournalRecordType::MOVE:
+        put_int(payload, record.index);
+        put_int(payload, record.new_ordinal);
+        break;
+    case JournalRecordType::CHANGE_DATE:
+    case JournalRecordType::EPOCH:
+        break;
+    case JournalRecordType::SERIES:
+        put_int(payload, record.start);
+        put_int(payload, record.end);
+        put_string(payload, record.name);
+        put_string(payload, record.description);
+        put_int(payload, (int32_t)record.rule.frequency);
+        put_int(payload, record.rule.interval);
+        put_int(payload, record.rule.count);
+        put_int(payload, record.rule.has_until);
+        put_int(payload, record.rule.has_until ? day_ordinal(record.rule.until) : 0);
+        break;
+    case JournalRecordType::EXCEPTION:
+        put_int(payload, record.index);
+        break;
+    }
+
+    uint32_t length = payload.size();
+    uint32_t sum = checksum(payload.data(), payload.size());
+
+    lock_guard<mutex> lock(mutex_);
+    // the flusher thread starts timing the new group
+    if (buffer_.empty())
+    {
+        group_started_ = chrono::steady_clock::now();
+        group_waiting_.notify_one();
+    }
+    buffer_.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    buffer_.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+    buffer_ += payload;
+
+    // group commit: the whole group is written and synced at once
+    buffered_records_++;
+    if (buffered_records_ >= group_size_)
+        sync_locked();
+}
+
+bool Journal::sync()
+{
+    lock_guard<mutex> lock(mutex_);
+    return sync_locked();
+}
+
+/* A failed write keeps only the part that was not written, so the
+ * next sync does not write the same records twice.
+ */
+bool Journal::sync_locked()
+{
+    if (fd_ < 0 || buffer_.empty())
+        return fd_ >= 0;
+
+    size_t written = 0;
+    bool ok = true;
+    while (written < buffer_.size())
+    {
+        ssize_t result = ::write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0)
+        {
+            ok = false;
+            break;
+        }
+        written += result;
+    }
+    buffer_.erase(0, written);
+    if (!ok)
+        return false;
+
+    buffered_records_ = 0;
+    return ::fsync(fd_) == 0;
+}
+
+bool Journal::truncate()
+{
+    lock_guard<mutex> lock(mutex_);
+    buffer_.clear();
+    buffered_records_ = 0;
+    return fd_ >= 0 && ::ftruncate(fd_, 0) == 0 && ::fsync(fd_) == 0;
+}
+
+int Journal::replay(const string& file_name,
+                    const function<void(const JournalRecord&)>& apply)
+{
+    ifstream file(file_name, ios::binary);
+    if (!file)
+        return -1;
+
+    vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    file.close();
+
+    int records = 0;
+    size_t position = 0;
+    while (data.size() - position >= FRAME_HEADER_SIZE)
+    {
+        uint32_t length = 0;
+        uint32_t sum = 0;
+        memcpy(&length, data.data() + position, sizeof(length));
+        memcpy(&sum, data.data() + position + sizeof(length), sizeof(sum));
+
+        const char* payload = data.data() + position + FRAME_HEADER_SIZE;
+        JournalRecord record;
+        if (data.size() - position - FRAME_HEADER_SIZE < length ||
+            checksum(payload, length) != sum || !decode(payload, length, record))
+            break;
+
+        apply(record);
+        records++;
+        position += FRAME_HEADER_SIZE + length;
+    }
+
+    // drop a torn record so new records are not written after it
+    if (position < data.size())
+    {
+        if (::truncate(file_name.c_str(), position) != 0)
+            return -1;
+    }
+    return records;
+}
@@ -0,0 +1,137 @@
+/*
+ * Journal is an append-only log of calendar changes. It is
+ * used together with snapshots: after a crash the latest
+ * snapshot is loaded and the journal replayed on top of it.
+ *
+ * Every record is framed with its length and a checksum so a
+ * record torn by a crash is noticed and dropped on replay.
+ * Records are collected to a buffer and written and synced to
+ * disk as a group, either when the group is full, when sync()
+ * is called or, at the latest, when the first record of the
+ * group has waited for the maximum delay. The delay is kept by
+ * a background thread, so a change is on disk soon even if no
+ * other change follows it.
+ */
+
+#ifndef JOURNAL_HH
+#define JOURNAL_HH
+
+#include "time.hh"
+#include "recurrence.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class JournalRecordType : std::uint8_t {
+    ADD = 1,
+    DELETE = 2,
+    MOVE = 3,
+    CHANGE_DATE = 4,
+    EPOCH = 5,
+    SERIES = 6,
+    EXCEPTION = 7
+};
+
+struct JournalRecord
+{
+    JournalRecord(JournalRecordType record_type = JournalRecordType::ADD):
+        type(record_type) {}
+
+    JournalRecordType type;
+    // day the change concerns (chosen date for CHANGE_DATE,
+    // epoch number for EPOCH, first date for SERIES)
+    int ordinal = 0;
+    // 1-based index of the event among the stored events of the day
+    // (DELETE, MOVE), id of the series (EXCEPTION)
+    int index = 0;
+    // day the event is moved to (MOVE)
+    int new_ordinal = 0;
+    // event data (ADD, SERIES)
+    Time::Minutes start = 0;
+    Time::Minutes end = 0;
+    std::string name;
+    std::string description;
+    // how the series repeats (SERIES)
+    RecurrenceRule rule;
+};
+
+class Journal
+{
+public:
+    /**
+     * @brief Journal
+     * @param group_size amount of records written and synced together
+     * @param max_delay_ms longest time a record waits for its group
+     * before it is synced anyway, 0 for no time limit
+     */
+    Journal(int group_size = 64, int max_delay_ms = 10);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    /**
+     * @brief open opens the journal for appending. Call replay first,
+     * so that a torn record at the end of the file is cut off.
+     * @param file_name path of the journal
+     * @return false if the file could not be opened
+     */
+    bool open(const std::string& file_name);
+
+    /**
+     * @brief append adds a record to the current group
+     * @param record the change to be recorded
+     */
+    void append(const JournalRecord& record);
+
+    /**
+     * @brief sync writes the current group to the file and syncs it to disk
+     * @return false if writing failed
+     */
+    bool sync();
+
+    /**
+     * @brief truncate removes all records, used after a snapshot has
+     * been written
+     * @return false if the file could not be truncated
+     */
+    bool truncate();
+
+    /**
+     * @brief replay reads all complete records of a journal file in order
+     * and cuts off a torn record from the end of the file, if there is one
+     * @param file_name path of the journal
+     * @param apply called for every record
+     * @return amount of records read, -1 if the file could not be read
+     */
+    static int replay(const std::string& file_name,
+                      const std::function<void(const JournalRecord&)>& apply);
+
+private:
+    int group_size_;
+    std::chrono::milliseconds max_delay_;
+    int fd_ = -1;
+    // records not yet written to the file
+    std::string buffer_;
+    int buffered_records_ = 0;
+    // when the first record of the current group was appended
+    std::chrono::steady_clock::time_point group_started_;
+
+    // guards the members above, the flusher thread syncs too
+    std::mutex mutex_;
+    std::condition_variable group_waiting_;
+    bool stopping_ = false;
+    std::thread flusher_;
+
+    // syncs groups whose first record has waited max_delay_
+    void flush_late_groups();
+    // sync() with mutex_ held
+    bool sync_locked();
+};
+
+#endif // JOURNAL_HH
@@ -0,0 +1,149 @@
+#include "loadgenerator.hh"
+#include "calendarclient.hh"
+#include "dayordinal.hh"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+using Clock = chrono::steady_clock;
+
+struct ClientResult
+{
+    vector<float> latencies_us;
+    long failed = 0;
+    bool broken = false;
+};
+
+/* Adds a random request of the mix to the buffer of the client. */
+void add_random_request(CalendarClient& client, mt19937& random,
+                        const vector<string>& calendars, int first_day)
+{
+    const string& calendar = calendars.at(random() % calendars.size());
+    Date date = date_from_ordinal(first_day + random() % 366);
+    Time::Minutes start = (random() % 92) * 15;
+
+    unsigned kind = random() % 10;
+    if (kind < 4)
+        client.request_add(calendar, date, start, start + 30, "Load test",
+                           "Added by the load generator");
+    else if (kind < 7)
+        client.request_count(calendar, date);
+    else if (kind < 9)
+        client.request_day(calendar, date);
+    else
+        client.request_conflict(calendar, date, start, start + 60);
+}
+
+/* Keeps the pipeline full. New requests are written together when
+ * half of the ones on the way have been answered.
+ */
+void run_client(const LoadOptions& options, unsigned seed, ClientResult& result)
+{
+    CalendarClient client;
+    if (!client.connect(options.socket_path))
+    {
+        result.broken = true;
+        return;
+    }
+
+    vector<string> calendars;
+    for (int i = 0; i < max(options.calendars, 1); ++i)
+    {
+        calendars.push_back("load-" + to_string(i));
+    }
+    mt19937 random(seed);
+    int first_day = day_ordinal(1, 1, 2024);
+    size_t pipeline = max(options.pipeline, 1);
+
+    vector<Clock::time_point> sent_at(max(options.requests, 0));
+    result.latencies_us.reserve(sent_at.size());
+    size_t sent = 0;
+    while (sent < sent_at.size() || client.pending() > 0)
+    {
+        if (sent < sent_at.size() && client.pending() <= pipeline / 2)
+        {
+            size_t batch_end = min(sent_at.size(), sent + pipeline - client.pending());
+            size_t batch_start = sent;
+            for (; sent < batch_end; ++sent)
+            {
+                add_random_request(client, random, calendars, first_day);
+            }
+            Clock::time_point now = Clock::now();
+            fill(sent_at.begin() + batch_start, sent_at.begin() + batch_end, now);
+            if (!client.flush())
+            {
+                result.broken = true;
+                return;
+            }
+        }
+
+        Frame response;
+        if (!client.receive(response) || response.request >= sent)
+        {
+            result.broken = true;
+            return;
+        }
+        chrono::duration<float, micro> latency = Clock::now() - sent_at.at(response.request);
+        result.latencies_us.push_back(latency.count());
+        if (response.code != (uint8_t)Status::OK)
+            result.failed++;
+    }
+}
+
+/* The value below which the given share of the sorted values are. */
+double percentile(const vector<float>& sorted, double share)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = min(sorted.size() - 1, (size_t)(share * sorted.size()));
+    return sorted.at(index);
+}
+}
+
+double LoadResult::requests_per_second() const
+{
+    return seconds > 0 ? requests / seconds : 0;
+}
+
+LoadResult generate_load(const LoadOptions& options)
+{
+    vector<ClientResult> clients(max(options.clients, 1));
+    vector<thread> threads;
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < clients.size(); ++i)
+    {
+        threads.emplace_back(run_client, cref(options), (unsigned)i + 1, ref(clients.at(i)));
+    }
+    for (thread& client : threads)
+    {
+        client.join();
+    }
+
+    LoadResult result;
+    result.seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<float> latencies;
+    for (const ClientResult& client : clients)
+    {
+        latencies.insert(latencies.end(), client.latencies_us.begin(),
+                         client.latencies_us.end());
+        result.failed += client.failed;
+        if (client.broken)
+            result.broken_clients++;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    result.requests = latencies.size();
+    result.p50_us = percentile(latencies, 0.50);
+    result.p90_us = percentile(latencies, 0.90);
+    result.p99_us = percentile(latencies, 0.99);
+    result.max_us = latencies.empty() ? 0 : latencies.back();
+    return result;
+}
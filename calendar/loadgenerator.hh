@@ -0,0 +1,55 @@
+/*
+ * Load generator for the calendar daemon. Many clients send
+ * a mix of requests to the daemon at the same time, each keeping
+ * a number of requests on the way (pipelining). The latency of
+ * every request is measured from the moment it is written to
+ * the socket until its response has been read.
+ *
+ * The mix is 40 % ADD, 30 % COUNT, 20 % DAY and 10 % CONFLICT,
+ * on random dates of one year in a few calendars.
+ */
+
+#ifndef LOADGENERATOR_HH
+#define LOADGENERATOR_HH
+
+#include <string>
+
+struct LoadOptions
+{
+    std::string socket_path;
+    int clients = 8;
+    // requests sent by each client
+    int requests = 10000;
+    // most requests a client has on the way at once
+    int pipeline = 32;
+    // amount of calendars the requests are spread over
+    int calendars = 4;
+};
+
+struct LoadResult
+{
+    long requests = 0;
+    // requests the server answered with other status than OK
+    long failed = 0;
+    // clients that could not connect or lost their connection
+    int broken_clients = 0;
+    double seconds = 0;
+
+    // latency percentiles in microseconds
+    double p50_us = 0;
+    double p90_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+
+    double requests_per_second() const;
+};
+
+/**
+ * @brief generate_load runs the clients against a running daemon
+ * and waits until all of them have their responses
+ * @param options where to connect and how much load to generate
+ * @return throughput and latency of the run
+ */
+LoadResult generate_load(const LoadOptions& options);
+
+#endif // LOADGENERATOR_HH
@@ -1,16 +1,150 @@
-#include "cli.hh"
-#include <iostream>
-
-using namespace std;
-
-int main() {
-    Cli *cli = new Cli(make_shared<Calendar>());
-
-    while (!cli->exec_prompt()) {
-        cout << endl;
-    }
-
-    delete cli;
-
-    return 0;
-}
+#include "cli.hh"
+#include "batchrunner.hh"
+#include "calendarserver.hh"
+#include "loadgenerator.hh"
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+const int SCRIPT_BUFFER_SIZE = 1 << 20;
+
+// Runs the commands of a script file ("-" for standard input)
+// and reports the throughput to standard error.
+static bool run_script(Cli& cli, const string& script_file) {
+    vector<char> buffer(SCRIPT_BUFFER_SIZE);
+    ifstream file;
+    if (script_file != "-") {
+        file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        file.open(script_file);
+        if (!file) {
+            cerr << "Error: could not open script " << script_file << "." << endl;
+            return false;
+        }
+    }
+    istream script(script_file == "-" ? cin.rdbuf() : file.rdbuf());
+
+    BufferedWriter output(STDOUT_FILENO);
+    BatchResult result = run_batch(cli, script, output);
+
+    cerr << result.commands << " commands in " << result.seconds << " s ("
+         << result.commands_per_second() << " commands/s)" << endl;
+    if (!result.output_ok) {
+        cerr << "Error: could not write output." << endl;
+    }
+    return result.output_ok;
+}
+
+// the running daemon, stopped by SIGINT and SIGTERM
+static CalendarServer* running_server = nullptr;
+
+static void stop_server(int) {
+    if (running_server != nullptr) {
+        running_server->stop();
+    }
+}
+
+// Serves the calendars over the socket until the process is stopped.
+static int run_server(const string& socket_path, int workers) {
+    CalendarServer server(workers);
+    if (!server.listen(socket_path)) {
+        cerr << "Error: could not listen to " << socket_path << "." << endl;
+        return 1;
+    }
+
+    running_server = &server;
+    signal(SIGINT, stop_server);
+    signal(SIGTERM, stop_server);
+    server.run();
+    running_server = nullptr;
+
+    cerr << server.calendar_count() << " calendars served." << endl;
+    return 0;
+}
+
+// Runs the load generator against a daemon and reports the results.
+static int run_load(const LoadOptions& options) {
+    LoadResult result = generate_load(options);
+    cout << result.requests << " requests in " << result.seconds << " s ("
+         << result.requests_per_second() << " requests/s)" << endl;
+    cout << "latency us: p50 " << result.p50_us << ", p90 " << result.p90_us
+         << ", p99 " << result.p99_us << ", max " << result.max_us << endl;
+    if (result.failed > 0) {
+        cout << result.failed << " requests failed." << endl;
+    }
+    if (result.broken_clients > 0) {
+        cerr << "Error: " << result.broken_clients << " clients lost the connection." << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Usage: calendar [--batch SCRIPT_FILE] [SNAPSHOT_FILE [JOURNAL_FILE]]
+//        calendar --serve SOCKET [WORKERS]
+//        calendar --load SOCKET [CLIENTS [REQUESTS [PIPELINE]]]
+// If a snapshot file is given, events are loaded from it on start
+// and written back to it when the program quits. If also a journal
+// file is given, changes made after the snapshot are replayed from it
+// on start and every change is recorded to it while running.
+// With --batch the commands are read from the script file ("-" reads
+// them from standard input) without prompts, and the output is
+// written in large blocks.
+// With --serve the program is a daemon that hosts named calendars
+// for many clients over a Unix socket (see calendarserver.hh). With
+// --load it is a client that measures the throughput and latency
+// of a running daemon; REQUESTS is the amount sent by each client.
+int main(int argc, char* argv[]) {
+    if (argc > 2 && string(argv[1]) == "--serve") {
+        return run_server(argv[2], argc > 3 ? stoi(argv[3]) : 0);
+    }
+    if (argc > 2 && string(argv[1]) == "--load") {
+        LoadOptions options;
+        options.socket_path = argv[2];
+        if (argc > 3) options.clients = stoi(argv[3]);
+        if (argc > 4) options.requests = stoi(argv[4]);
+        if (argc > 5) options.pipeline = stoi(argv[5]);
+        return run_load(options);
+    }
+
+    string script_file;
+    int first_file = 1;
+    if (argc > 2 && string(argv[1]) == "--batch") {
+        script_file = argv[2];
+        first_file = 3;
+        // cin and cout are not mixed with C stdio, so they can buffer freely
+        ios::sync_with_stdio(false);
+    }
+
+    shared_ptr<Calendar> calendar = make_shared<Calendar>();
+
+    string snapshot_file = argc > first_file ? argv[first_file] : "";
+    string journal_file = argc > first_file + 1 ? argv[first_file + 1] : "";
+    if (!snapshot_file.empty() && !calendar->load_snapshot(snapshot_file)) {
+        cout << "Starting with an empty calendar, snapshot not loaded." << endl;
+    }
+    if (!journal_file.empty() && !calendar->open_journal(journal_file)) {
+        cout << "Error: could not open journal." << endl;
+    }
+
+    Cli *cli = new Cli(calendar);
+
+    if (!script_file.empty()) {
+        run_script(*cli, script_file);
+    } else {
+        while (!cli->exec_prompt()) {
+            cout << endl;
+        }
+    }
+
+    delete cli;
+
+    // writing the snapshot also empties the journal
+    if (!snapshot_file.empty() && !calendar->save_snapshot(snapshot_file)) {
+        cout << "Error: could not write snapshot." << endl;
+    }
+
+    return 0;
+}
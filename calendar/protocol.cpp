@@ -0,0 +1,168 @@
+#include "protocol.hh"
+#include "dayordinal.hh"
+#include <cstring>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+// dates are limited to years 1-9999
+const int FIRST_ORDINAL = day_ordinal(1, 1, 1);
+const int LAST_ORDINAL = day_ordinal(31, 12, 9999);
+
+template <typename T>
+void append(string& buffer, const T& value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+}
+
+long parse_frame(string_view data, Frame& frame)
+{
+    if (data.size() < sizeof(uint32_t))
+        return 0;
+
+    uint32_t length = 0;
+    memcpy(&length, data.data(), sizeof(length));
+    if (length < FRAME_HEADER_SIZE - sizeof(uint32_t) || length > MAX_FRAME_SIZE)
+        return -1;
+
+    size_t size = sizeof(uint32_t) + length;
+    if (data.size() < size)
+        return 0;
+
+    memcpy(&frame.request, data.data() + sizeof(uint32_t), sizeof(frame.request));
+    frame.code = (uint8_t)data[2 * sizeof(uint32_t)];
+    frame.payload = data.substr(FRAME_HEADER_SIZE, size - FRAME_HEADER_SIZE);
+    return (long)size;
+}
+
+FrameBuilder::FrameBuilder(string& buffer, uint32_t request, uint8_t code):
+    buffer_(buffer), start_(buffer.size())
+{
+    // the length is written by finish()
+    append(buffer_, uint32_t(0));
+    append(buffer_, request);
+    append(buffer_, code);
+}
+
+FrameBuilder& FrameBuilder::add_u8(uint8_t value)
+{
+    append(buffer_, value);
+    return *this;
+}
+
+FrameBuilder& FrameBuilder::add_u32(uint32_t value)
+{
+    append(buffer_, value);
+    return *this;
+}
+
+FrameBuilder& FrameBuilder::add_i32(int32_t value)
+{
+    append(buffer_, value);
+    return *this;
+}
+
+FrameBuilder& FrameBuilder::add_date(const Date& date)
+{
+    return add_i32(day_ordinal(date));
+}
+
+FrameBuilder& FrameBuilder::add_text(string_view text)
+{
+    uint16_t length = (uint16_t)min<size_t>(text.size(), numeric_limits<uint16_t>::max());
+    append(buffer_, length);
+    buffer_.append(text.data(), length);
+    return *this;
+}
+
+void FrameBuilder::set_code(uint8_t code)
+{
+    buffer_[start_ + 2 * sizeof(uint32_t)] = (char)code;
+}
+
+void FrameBuilder::clear_payload()
+{
+    buffer_.resize(start_ + FRAME_HEADER_SIZE);
+}
+
+size_t FrameBuilder::length() const
+{
+    return buffer_.size() - start_ - sizeof(uint32_t);
+}
+
+void FrameBuilder::finish()
+{
+    uint32_t length = (uint32_t)this->length();
+    memcpy(&buffer_[start_], &length, sizeof(length));
+}
+
+PayloadReader::PayloadReader(string_view payload):
+    data_(payload)
+{
+}
+
+bool PayloadReader::read_bytes(void* target, size_t size)
+{
+    if (!ok_ || data_.size() < size)
+    {
+        ok_ = false;
+        return false;
+    }
+    memcpy(target, data_.data(), size);
+    data_.remove_prefix(size);
+    return true;
+}
+
+bool PayloadReader::read_u8(uint8_t& value)
+{
+    return read_bytes(&value, sizeof(value));
+}
+
+bool PayloadReader::read_u32(uint32_t& value)
+{
+    return read_bytes(&value, sizeof(value));
+}
+
+bool PayloadReader::read_i32(int32_t& value)
+{
+    return read_bytes(&value, sizeof(value));
+}
+
+bool PayloadReader::read_date(Date& date)
+{
+    int32_t ordinal = 0;
+    if (!read_i32(ordinal))
+        return false;
+
+    if (ordinal < FIRST_ORDINAL || ordinal > LAST_ORDINAL)
+    {
+        ok_ = false;
+        return false;
+    }
+    date = date_from_ordinal(ordinal);
+    return true;
+}
+
+bool PayloadReader::read_text(string_view& text)
+{
+    uint16_t length = 0;
+    if (!read_bytes(&length, sizeof(length)))
+        return false;
+
+    if (data_.size() < length)
+    {
+        ok_ = false;
+        return false;
+    }
+    text = data_.substr(0, length);
+    data_.remove_prefix(length);
+    return true;
+}
+
+bool PayloadReader::complete() const
+{
+    return ok_ && data_.empty();
+}
@@ -0,0 +1,143 @@
+/*
+ * Protocol of the calendar daemon (see calendarserver.hh).
+ *
+ * Requests and responses are frames:
+ *
+ *   length:  uint32, size of the rest of the frame
+ *   request: uint32, chosen by the client and copied to the response
+ *   code:    uint8, Command of a request or Status of a response
+ *   payload: fields of the command or of its result
+ *
+ * Integers are in host byte order, as the socket is local. Dates
+ * are day ordinals (see dayordinal.hh) and texts a uint16 length
+ * followed by the bytes. Every request starts with the name of the
+ * calendar it is for, calendars are created when first named:
+ *
+ *   ADD       calendar, date, start, end, name, description
+ *   DELETE    calendar, date, index (1-based, as in the Cli)
+ *   MOVE      calendar, date, index, new date
+ *   COUNT     calendar, date              -> count
+ *   DAY       calendar, date              -> count, {start, end, name, description}
+ *   CONFLICT  calendar, date, start, end  -> uint8, 1 if the time is taken
+ *
+ * A response has the result fields only if its status is OK. A DAY
+ * whose events do not fit in one frame gets TOO_LARGE.
+ *
+ * A client may send many requests without waiting for the responses.
+ * The responses of a connection come in the order of its requests.
+ */
+
+#ifndef PROTOCOL_HH
+#define PROTOCOL_HH
+
+#include "date.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+enum class Command : std::uint8_t
+{
+    ADD = 1,
+    DELETE = 2,
+    MOVE = 3,
+    COUNT = 4,
+    DAY = 5,
+    CONFLICT = 6
+};
+
+enum class Status : std::uint8_t
+{
+    OK = 0,
+    // the command was valid but could not be done, e.g. no such event
+    FAILED = 1,
+    // unknown command or missing fields
+    BAD_REQUEST = 2,
+    // the result would be larger than MAX_FRAME_SIZE
+    TOO_LARGE = 3
+};
+
+// bytes of the length, request and code fields
+const std::size_t FRAME_HEADER_SIZE = 9;
+// a larger frame means a broken client
+const std::uint32_t MAX_FRAME_SIZE = 1 << 20;
+
+// a frame read from a buffer, the payload points into the buffer
+struct Frame
+{
+    std::uint32_t request;
+    std::uint8_t code;
+    std::string_view payload;
+};
+
+/**
+ * @brief parse_frame reads the frame at the start of the data
+ * @param data received bytes
+ * @param frame set to the frame if it is complete
+ * @return size of the frame in bytes, 0 if the frame has not been
+ * fully received yet and -1 if it is invalid
+ */
+long parse_frame(std::string_view data, Frame& frame);
+
+/*
+ * FrameBuilder appends a frame to a buffer one field at a time.
+ * The length of the frame is filled in by finish().
+ */
+class FrameBuilder
+{
+public:
+    FrameBuilder(std::string& buffer, std::uint32_t request, std::uint8_t code);
+
+    FrameBuilder& add_u8(std::uint8_t value);
+    FrameBuilder& add_u32(std::uint32_t value);
+    FrameBuilder& add_i32(std::int32_t value);
+    FrameBuilder& add_date(const Date& date);
+    // texts longer than 65535 bytes are cut
+    FrameBuilder& add_text(std::string_view text);
+
+    // changes the code given to the constructor
+    void set_code(std::uint8_t code);
+    // removes the fields added so far
+    void clear_payload();
+    // size of the frame without its length field, as in the length field
+    std::size_t length() const;
+    void finish();
+
+private:
+    std::string& buffer_;
+    // where the frame starts in buffer_
+    std::size_t start_;
+};
+
+/*
+ * PayloadReader reads the fields of a payload in order. A read
+ * fails if the payload ends too early or a date is out of range,
+ * and after a failure every read fails.
+ */
+class PayloadReader
+{
+public:
+    explicit PayloadReader(std::string_view payload);
+
+    bool read_u8(std::uint8_t& value);
+    bool read_u32(std::uint32_t& value);
+    bool read_i32(std::int32_t& value);
+    bool read_date(Date& date);
+    // the text points into the payload
+    bool read_text(std::string_view& text);
+
+    /**
+     * @brief complete
+     * @return true if every read succeeded and the whole payload was read
+     */
+    bool complete() const;
+
+private:
+    std::string_view data_;
+    bool ok_ = true;
+
+    bool read_bytes(void* target, std::size_t size);
+};
+
+#endif // PROTOCOL_HH
@@ -0,0 +1,192 @@
+#include "recurrence.hh"
+#include "dayordinal.hh"
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+using namespace std;
+
+// the calendar repeats itself every 400 years
+const int MONTHS_IN_CYCLE = 400 * 12;
+// a series that would go on past this month has no end in practice,
+// and the day ordinals of later years would not fit in an int
+const long long LAST_MONTH = 1000000LL * 12;
+
+Recurrence::Recurrence(Date first_date, string name, Time::Minutes start,
+                       Time::Minutes end, string description, RecurrenceRule rule):
+    name_(std::move(name)), start_(start), end_(end),
+    description_(std::move(description)), rule_(rule),
+    first_ordinal_(day_ordinal(first_date)), last_ordinal_(INT_MAX),
+    first_month_(month_index(first_date)), day_of_month_(first_date.day())
+{
+    if (rule_.interval < 1)
+        rule_.interval = 1;
+
+    if (rule_.has_until)
+        last_ordinal_ = day_ordinal(rule_.until);
+
+    if (rule_.count > 0)
+    {
+        int last_by_count = first_ordinal_;
+        if (rule_.frequency == Frequency::MONTHLY)
+        {
+            last_by_count = last_monthly_by_count();
+        }
+        else
+        {
+            // a large count or interval would overflow an int
+            long long last = first_ordinal_ + (long long)(rule_.count - 1) * period();
+            last_by_count = (int)min<long long>(last, INT_MAX);
+        }
+        last_ordinal_ = min(last_ordinal_, last_by_count);
+    }
+}
+
+long long Recurrence::period() const
+{
+    return (rule_.frequency == Frequency::DAILY ? 1LL : 7LL) * rule_.interval;
+}
+
+int Recurrence::month_index(const Date& date)
+{
+    return date.year() * 12 + date.month() - 1;
+}
+
+bool Recurrence::month_has_day(int month) const
+{
+    return day_of_month_ <= Date::days_in_month(month % 12 + 1, month / 12);
+}
+
+/* Months without the day do not count. Which months have it repeats
+ * every 400 years, so whole cycles are skipped at once and at most
+ * one cycle of months is stepped through, however large the count is.
+ */
+int Recurrence::last_monthly_by_count() const
+{
+    // steps of the series in one cycle and the occurrences among them
+    int steps = MONTHS_IN_CYCLE / gcd(rule_.interval, MONTHS_IN_CYCLE);
+    int per_cycle = 0;
+    for (int step = 0; step < steps; ++step)
+    {
+        if (month_has_day(first_month_ + step * rule_.interval))
+            per_cycle++;
+    }
+
+    // the first month has the day, so per_cycle is at least one
+    long long cycles = (rule_.count - 1) / per_cycle;
+    int remaining = rule_.count - (int)(cycles * per_cycle);
+    long long month = first_month_ + cycles * steps * rule_.interval;
+    if (month > LAST_MONTH)
+        return INT_MAX;
+    for (;; month += rule_.interval)
+    {
+        if (month_has_day((int)month) && --remaining == 0)
+            break;
+    }
+    return day_ordinal(day_of_month_, (int)(month % 12) + 1, (int)(month / 12));
+}
+
+bool Recurrence::matches(int ordinal) const
+{
+    if (ordinal < first_ordinal_ || ordinal > last_ordinal_)
+        return false;
+
+    if (rule_.frequency == Frequency::MONTHLY)
+    {
+        Date date = date_from_ordinal(ordinal);
+        return date.day() == day_of_month_ &&
+               (month_index(date) - first_month_) % rule_.interval == 0;
+    }
+
+    return (ordinal - first_ordinal_) % period() == 0;
+}
+
+bool Recurrence::occurs_on(int ordinal) const
+{
+    return matches(ordinal) && exceptions_.count(ordinal) == 0;
+}
+
+vector<int> Recurrence::occurrences(int first, int last) const
+{
+    vector<int> result;
+    first = max(first, first_ordinal_);
+    last = min(last, last_ordinal_);
+    if (first > last)
+        return result;
+
+    if (rule_.frequency == Frequency::MONTHLY)
+    {
+        // go through the months of the range that the series repeats in
+        Date first_date = date_from_ordinal(first);
+        long long month = month_index(first_date);
+        long long offset = (month - first_month_) % rule_.interval;
+        if (offset != 0)
+            month += rule_.interval - offset;
+
+        int last_month = month_index(date_from_ordinal(last));
+        for (; month <= last_month; month += rule_.interval)
+        {
+            int year = (int)(month / 12);
+            int month_number = (int)(month % 12) + 1;
+            if (day_of_month_ > Date::days_in_month(month_number, year))
+                continue;
+
+            int ordinal = day_ordinal(day_of_month_, month_number, year);
+            if (ordinal > last)
+                break;
+            if (ordinal >= first && exceptions_.count(ordinal) == 0)
+                result.push_back(ordinal);
+        }
+        return result;
+    }
+
+    long long step = period();
+    // first occurrence at or after first
+    long long ordinal = first_ordinal_ + (first - first_ordinal_ + step - 1) / step * step;
+    for (; ordinal <= last; ordinal += step)
+    {
+        if (exceptions_.count((int)ordinal) == 0)
+            result.push_back((int)ordinal);
+    }
+    return result;
+}
+
+void Recurrence::add_exception(int ordinal)
+{
+    exceptions_.insert(ordinal);
+}
+
+int Recurrence::first_ordinal() const
+{
+    return first_ordinal_;
+}
+
+const RecurrenceRule& Recurrence::rule() const
+{
+    return rule_;
+}
+
+const set<int>& Recurrence::exceptions() const
+{
+    return exceptions_;
+}
+
+const string& Recurrence::name() const
+{
+    return name_;
+}
+
+const string& Recurrence::description() const
+{
+    return description_;
+}
+
+Time::Minutes Recurrence::start() const
+{
+    return start_;
+}
+
+Time::Minutes Recurrence::end() const
+{
+    return end_;
+}
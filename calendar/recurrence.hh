@@ -0,0 +1,111 @@
+/*
+ * Recurrence describes an event that repeats daily, weekly or
+ * monthly. The series is stored once and its occurrences are
+ * only calculated when a date is looked at, so a repeating
+ * event costs the same no matter how long it runs.
+ *
+ * A series ends at an end date, after a count of occurrences,
+ * or never. Single occurrences can be left out with exceptions.
+ * Monthly series repeat on the same day of month and skip
+ * months that do not have that day.
+ */
+
+#ifndef RECURRENCE_HH
+#define RECURRENCE_HH
+
+#include "date.hh"
+#include "time.hh"
+
+#include <set>
+#include <string>
+#include <vector>
+
+enum class Frequency {
+    DAILY,
+    WEEKLY,
+    MONTHLY
+};
+
+struct RecurrenceRule
+{
+    Frequency frequency = Frequency::WEEKLY;
+    // repeat every interval:th day, week or month
+    int interval = 1;
+    // amount of occurrences, 0 if not limited by count
+    int count = 0;
+    // last possible date, used only if has_until is set
+    bool has_until = false;
+    Date until;
+};
+
+class Recurrence
+{
+public:
+    /**
+     * @brief Recurrence
+     * @param first_date date of the first occurrence
+     * @param rule how the event repeats
+     */
+    Recurrence(Date first_date, std::string name, Time::Minutes start,
+               Time::Minutes end, std::string description, RecurrenceRule rule);
+
+    /**
+     * @brief occurs_on
+     * @param ordinal day ordinal of a date
+     * @return true if the series has an occurrence on the date
+     */
+    bool occurs_on(int ordinal) const;
+
+    /**
+     * @brief occurrences
+     * @return day ordinals of the occurrences between first and last
+     * (both included) in increasing order
+     */
+    std::vector<int> occurrences(int first, int last) const;
+
+    /**
+     * @brief add_exception leaves the occurrence of a date out
+     * @param ordinal day ordinal of the date
+     */
+    void add_exception(int ordinal);
+
+    /**
+     * @brief first_ordinal
+     * @return day ordinal of the first occurrence
+     */
+    int first_ordinal() const;
+    const RecurrenceRule& rule() const;
+    const std::set<int>& exceptions() const;
+
+    const std::string& name() const;
+    const std::string& description() const;
+    Time::Minutes start() const;
+    Time::Minutes end() const;
+
+private:
+    // checks the rule without exceptions
+    bool matches(int ordinal) const;
+    // days between occurrences of a daily or weekly series
+    long long period() const;
+    // month number used for monthly series
+    static int month_index(const Date& date);
+    // true if the month of the month number has the day of the series
+    bool month_has_day(int month) const;
+    // ordinal of the last occurrence of a monthly series with a count
+    int last_monthly_by_count() const;
+
+    std::string name_;
+    Time::Minutes start_;
+    Time::Minutes end_;
+    std::string description_;
+    RecurrenceRule rule_;
+
+    int first_ordinal_;
+    // ordinal of the last possible occurrence
+    int last_ordinal_;
+    int first_month_;
+    int day_of_month_;
+    std::set<int> exceptions_;
+};
+
+#endif // RECURRENCE_HH
@@ -0,0 +1,174 @@
+#include "reminderqueue.hh"
+
+using namespace std;
+
+namespace
+{
+
+// position of an event that has no reminder
+const int NOT_QUEUED = -1;
+
+// slot index of the handle (see eventpool.hh), the handles of a slot
+// share its position and the reminder tells which one it is for
+uint32_t slot_of(EventId id)
+{
+    return (uint32_t)id;
+}
+
+}
+
+Instant to_instant(int ordinal, Time::Minutes time)
+{
+    return (Instant)ordinal * 24 * 60 + time;
+}
+
+bool ReminderQueue::before(const Reminder& reminder1, const Reminder& reminder2)
+{
+    if (reminder1.due != reminder2.due)
+        return reminder1.due < reminder2.due;
+    return reminder1.id < reminder2.id;
+}
+
+void ReminderQueue::place(int index, const Reminder& reminder)
+{
+    heap_.at(index) = reminder;
+    position_.at(slot_of(reminder.id)) = index;
+}
+
+void ReminderQueue::sift_up(int index)
+{
+    Reminder reminder = heap_.at(index);
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (!before(reminder, heap_.at(parent)))
+            break;
+        place(index, heap_.at(parent));
+        index = parent;
+    }
+    place(index, reminder);
+}
+
+void ReminderQueue::sift_down(int index)
+{
+    Reminder reminder = heap_.at(index);
+    int size = (int)heap_.size();
+    while (true)
+    {
+        int child = 2 * index + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && before(heap_.at(child + 1), heap_.at(child)))
+            child++;
+        if (!before(heap_.at(child), reminder))
+            break;
+        place(index, heap_.at(child));
+        index = child;
+    }
+    place(index, reminder);
+}
+
+/* The last reminder takes the place of the removed one and is moved
+ * up or down to where it belongs.
+ */
+void ReminderQueue::erase_at(int index)
+{
+    position_.at(slot_of(heap_.at(index).id)) = NOT_QUEUED;
+    Reminder last = heap_.back();
+    heap_.pop_back();
+    if (index == (int)heap_.size())
+        return;
+
+    place(index, last);
+    sift_up(index);
+    sift_down(position_.at(slot_of(last.id)));
+}
+
+/* A reminder left for an earlier event of the same slot is replaced. */
+void ReminderQueue::set(EventId id, Instant due)
+{
+    uint32_t slot = slot_of(id);
+    if (slot >= position_.size())
+        position_.resize(slot + 1, NOT_QUEUED);
+
+    int index = position_.at(slot);
+    if (index != NOT_QUEUED && heap_.at(index).id != id)
+    {
+        erase_at(index);
+        index = NOT_QUEUED;
+    }
+    if (index == NOT_QUEUED)
+    {
+        heap_.push_back({due, id});
+        position_.at(slot) = (int)heap_.size() - 1;
+        sift_up((int)heap_.size() - 1);
+        return;
+    }
+
+    heap_.at(index).due = due;
+    sift_up(index);
+    sift_down(position_.at(slot));
+}
+
+void ReminderQueue::remove(EventId id)
+{
+    if (contains(id))
+        erase_at(position_.at(slot_of(id)));
+}
+
+bool ReminderQueue::top(Reminder& reminder) const
+{
+    if (heap_.empty())
+        return false;
+    reminder = heap_.front();
+    return true;
+}
+
+void ReminderQueue::pop()
+{
+    if (!heap_.empty())
+        erase_at(0);
+}
+
+bool ReminderQueue::contains(EventId id) const
+{
+    uint32_t slot = slot_of(id);
+    return slot < position_.size() && position_.at(slot) != NOT_QUEUED &&
+           heap_.at(position_.at(slot)).id == id;
+}
+
+size_t ReminderQueue::size() const
+{
+    return heap_.size();
+}
+
+bool ReminderQueue::empty() const
+{
+    return heap_.empty();
+}
+
+void ReminderQueue::clear()
+{
+    heap_.clear();
+    position_.clear();
+}
+
+SimulatedClock::SimulatedClock(Instant start):
+    now_(start)
+{
+}
+
+Instant SimulatedClock::now() const
+{
+    return now_;
+}
+
+void SimulatedClock::set(Instant now)
+{
+    now_ = now;
+}
+
+void SimulatedClock::advance(Instant minutes)
+{
+    now_ += minutes;
+}
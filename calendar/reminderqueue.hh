@@ -0,0 +1,99 @@
+/*
+ * ReminderQueue keeps the pending reminders of events ordered
+ * by the instant they are due. It is a binary min-heap with an
+ * index from event slot to heap position, so the reminder of
+ * any event can be removed or moved in logarithmic time when
+ * the event is deleted or moved, and the next due reminder is
+ * always at the top.
+ *
+ * Instants are minutes since 1.1.1970 (see dayordinal.hh), so
+ * a date and a time map to one integer. SimulatedClock gives a
+ * deterministic "now" for tests and simulations.
+ */
+
+#ifndef REMINDERQUEUE_HH
+#define REMINDERQUEUE_HH
+
+#include "event.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// minutes since 1.1.1970 00:00
+using Instant = std::int64_t;
+
+/**
+ * @brief to_instant
+ * @param ordinal day ordinal of the date
+ * @param time minutes since the beginning of the day
+ * @return the instant of the time of the date
+ */
+Instant to_instant(int ordinal, Time::Minutes time);
+
+struct Reminder
+{
+    Instant due;
+    EventId id;
+};
+
+class ReminderQueue
+{
+public:
+    /**
+     * @brief set adds a reminder or changes the instant of an existing one
+     * @param id handle of the event
+     * @param due when the reminder is due
+     */
+    void set(EventId id, Instant due);
+
+    /**
+     * @brief remove removes the reminder of an event if it has one
+     * @param id handle of the event
+     */
+    void remove(EventId id);
+
+    /**
+     * @brief top gives the reminder that is due first
+     * @return false if there are no reminders
+     */
+    bool top(Reminder& reminder) const;
+
+    // removes the reminder that is due first
+    void pop();
+
+    bool contains(EventId id) const;
+    std::size_t size() const;
+    bool empty() const;
+    void clear();
+
+private:
+    std::vector<Reminder> heap_;
+    // heap index of the reminder of each event slot, NOT_QUEUED if none
+    std::vector<int> position_;
+
+    // earlier instant first, same instants by handle
+    static bool before(const Reminder& reminder1, const Reminder& reminder2);
+    // places the reminder at the index to heap_ and updates position_
+    void place(int index, const Reminder& reminder);
+    void sift_up(int index);
+    void sift_down(int index);
+    // removes the reminder at the index
+    void erase_at(int index);
+};
+
+class SimulatedClock
+{
+public:
+    explicit SimulatedClock(Instant start = 0);
+
+    Instant now() const;
+    void set(Instant now);
+    // moves the clock forward by the given amount of minutes
+    void advance(Instant minutes);
+
+private:
+    Instant now_;
+};
+
+#endif // REMINDERQUEUE_HH
@@ -0,0 +1,272 @@
+#include "searchindex.hh"
+#include "dayordinal.hh"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+using namespace std;
+
+bool SearchIndex::Posting::operator<(const Posting& other) const
+{
+    if (ordinal != other.ordinal)
+        return ordinal < other.ordinal;
+    return id < other.id;
+}
+
+/* Letters and digits form words, bytes of UTF-8 characters
+ * are kept as they are so words in other scripts also work.
+ */
+vector<string> split_words(string_view text)
+{
+    vector<string> words;
+    string word;
+    for (char ch : text)
+    {
+        unsigned char byte = (unsigned char)ch;
+        if (isalnum(byte) || byte >= 0x80)
+        {
+            word.push_back((char)tolower(byte));
+        }
+        else if (!word.empty())
+        {
+            words.push_back(word);
+            word.clear();
+        }
+    }
+    if (!word.empty())
+        words.push_back(word);
+    return words;
+}
+
+/* Splits an interned text the first time it is seen. */
+const vector<SearchIndex::PostingList*>& SearchIndex::lists_of(const string& text)
+{
+    unordered_map<const string*, vector<PostingList*>>::iterator iter =
+        text_words_.find(&text);
+    if (iter != text_words_.end())
+        return iter->second;
+
+    vector<PostingList*> lists;
+    for (const string& word : split_words(text))
+    {
+        lists.push_back(&postings_[word]);
+    }
+    return text_words_.insert({&text, lists}).first->second;
+}
+
+vector<SearchIndex::PostingList*> SearchIndex::lists_of(const Event& event)
+{
+    vector<PostingList*> lists = lists_of(event.name());
+    const vector<PostingList*>& description = lists_of(event.description());
+    lists.insert(lists.end(), description.begin(), description.end());
+
+    sort(lists.begin(), lists.end());
+    lists.erase(unique(lists.begin(), lists.end()), lists.end());
+    return lists;
+}
+
+void SearchIndex::forget_text(const string* text)
+{
+    text_words_.erase(text);
+}
+
+void SearchIndex::add(EventId id, const Event& event)
+{
+    Posting posting{day_ordinal(event.date()), id};
+    for (PostingList* list : lists_of(event))
+    {
+        list->insert(posting);
+    }
+}
+
+void SearchIndex::remove(EventId id, const Event& event)
+{
+    Posting posting{day_ordinal(event.date()), id};
+    for (PostingList* list : lists_of(event))
+    {
+        list->erase(posting);
+    }
+}
+
+void SearchIndex::move(EventId id, const Event& event, int new_ordinal)
+{
+    Posting old_posting{day_ordinal(event.date()), id};
+    Posting new_posting{new_ordinal, id};
+    for (PostingList* list : lists_of(event))
+    {
+        list->erase(old_posting);
+        list->insert(new_posting);
+    }
+}
+
+/* Collects the postings of the range from the list of the word, or from
+ * the lists of all words with the prefix.
+ */
+vector<SearchIndex::Posting> SearchIndex::matches(const string& word, bool prefix,
+                                                  int first, int last) const
+{
+    Posting range_start{first, 0};
+    vector<Posting> result;
+    map<string, PostingList>::const_iterator iter = postings_.lower_bound(word);
+    int lists = 0;
+    for (; iter != postings_.end(); ++iter)
+    {
+        if (prefix ? iter->first.compare(0, word.size(), word) != 0 : iter->first != word)
+            break;
+
+        const PostingList& list = iter->second;
+        for (PostingList::const_iterator posting = list.lower_bound(range_start);
+             posting != list.end() && posting->ordinal <= last; ++posting)
+        {
+            result.push_back(*posting);
+        }
+        lists++;
+    }
+
+    // postings of several words are merged, an event may have many of them
+    if (lists > 1)
+    {
+        sort(result.begin(), result.end());
+        result.erase(unique(result.begin(), result.end(),
+                            [](const Posting& a, const Posting& b) { return a.id == b.id; }),
+                     result.end());
+    }
+    return result;
+}
+
+vector<SearchIndex::QueryWord> SearchIndex::parse_query(const string& query)
+{
+    vector<QueryWord> query_words;
+    string_view rest(query);
+    while (!rest.empty())
+    {
+        // a query word is separated by spaces, it may still split into words
+        size_t end = min(rest.find(' '), rest.size());
+        string_view term = rest.substr(0, end);
+        rest.remove_prefix(min(end + 1, rest.size()));
+
+        bool prefix = !term.empty() && term.back() == '*';
+        vector<string> words = split_words(term);
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            // only the last part of a term like "q3-aud*" is a prefix
+            query_words.push_back({words.at(i), prefix && i + 1 == words.size()});
+        }
+    }
+    return query_words;
+}
+
+/* Intersects the matches of the words, starting from the fewest matches. */
+vector<EventId> SearchIndex::search(const string& query, int first, int last) const
+{
+    vector<vector<Posting>> word_matches;
+    for (const QueryWord& query_word : parse_query(query))
+    {
+        word_matches.push_back(matches(query_word.word, query_word.prefix, first, last));
+    }
+    if (word_matches.empty())
+        return {};
+
+    sort(word_matches.begin(), word_matches.end(),
+         [](const vector<Posting>& a, const vector<Posting>& b) { return a.size() < b.size(); });
+
+    vector<Posting> result = word_matches.front();
+    for (size_t i = 1; i < word_matches.size() && !result.empty(); ++i)
+    {
+        vector<Posting> both;
+        set_intersection(result.begin(), result.end(),
+                         word_matches.at(i).begin(), word_matches.at(i).end(),
+                         back_inserter(both));
+        result.swap(both);
+    }
+
+    vector<EventId> ids;
+    ids.reserve(result.size());
+    for (const Posting& posting : result)
+    {
+        ids.push_back(posting.id);
+    }
+    return ids;
+}
+
+void SearchIndex::add_unloaded_day(int ordinal, const vector<string>& words)
+{
+    for (const string& word : words)
+    {
+        day_postings_[word].insert(ordinal);
+    }
+}
+
+/* A day matches if it has every word, maybe in different events,
+ * so the days found are candidates that still have to be searched.
+ */
+vector<int> SearchIndex::unloaded_days(const string& query, int first, int last) const
+{
+    vector<int> result;
+    bool first_word = true;
+    for (const QueryWord& query_word : parse_query(query))
+    {
+        const string& word = query_word.word;
+        vector<int> days;
+        map<string, set<int>>::const_iterator iter = day_postings_.lower_bound(word);
+        for (; iter != day_postings_.end(); ++iter)
+        {
+            if (query_word.prefix ? iter->first.compare(0, word.size(), word) != 0
+                                  : iter->first != word)
+                break;
+
+            set<int>::const_iterator day = iter->second.lower_bound(first);
+            for (; day != iter->second.end() && *day <= last; ++day)
+                days.push_back(*day);
+        }
+        sort(days.begin(), days.end());
+        days.erase(unique(days.begin(), days.end()), days.end());
+
+        if (first_word)
+        {
+            result.swap(days);
+            first_word = false;
+            continue;
+        }
+        vector<int> both;
+        set_intersection(result.begin(), result.end(), days.begin(), days.end(),
+                         back_inserter(both));
+        result.swap(both);
+        if (result.empty())
+            break;
+    }
+    return result;
+}
+
+bool SearchIndex::text_matches(const string& query, string_view name,
+                               string_view description)
+{
+    vector<string> words = split_words(name);
+    vector<string> description_words = split_words(description);
+    words.insert(words.end(), description_words.begin(), description_words.end());
+
+    vector<QueryWord> query_words = parse_query(query);
+    for (const QueryWord& query_word : query_words)
+    {
+        bool found = false;
+        for (const string& word : words)
+        {
+            if (query_word.prefix ? word.compare(0, query_word.word.size(), query_word.word) == 0
+                                  : word == query_word.word)
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return !query_words.empty();
+}
+
+void SearchIndex::clear()
+{
+    postings_.clear();
+    text_words_.clear();
+    day_postings_.clear();
+}
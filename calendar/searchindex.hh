@@ -0,0 +1,138 @@
+/*
+ * SearchIndex is an inverted index over the words of event
+ * names and descriptions. Each word has a posting list of
+ * the events where it appears, ordered by the day ordinal
+ * of the event and its handle, so the events of a date range
+ * are found with a binary search in the list. The cost of a
+ * query depends on the matches in the range, not on the
+ * amount of events in the calendar.
+ *
+ * Events that are not loaded yet (days of a snapshot) are
+ * indexed only by their day, so a query tells which days
+ * have to be loaded without creating all the events first.
+ *
+ * Words are runs of letters and digits, compared without
+ * case. The words of each distinct (interned) text are
+ * split only once and reused by every event with the text.
+ */
+
+#ifndef SEARCHINDEX_HH
+#define SEARCHINDEX_HH
+
+#include "event.hh"
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class SearchIndex
+{
+public:
+    /**
+     * @brief add indexes the words of an event
+     * @param id handle of the event
+     * @param event the event, its texts must be interned
+     */
+    void add(EventId id, const Event& event);
+
+    /**
+     * @brief remove removes the event from the index
+     * @param event the event, still with the date it was indexed with
+     */
+    void remove(EventId id, const Event& event);
+
+    /**
+     * @brief forget_text drops the words kept for an interned text
+     * @param text a text freed from its pool, its address may be reused
+     */
+    void forget_text(const std::string* text);
+
+    /**
+     * @brief move updates the date of an event in the index
+     * @param event the event, still with its old date
+     * @param new_ordinal day ordinal of the new date
+     */
+    void move(EventId id, const Event& event, int new_ordinal);
+
+    /**
+     * @brief search finds the events that have every word of the query.
+     * A word ending with '*' matches all words starting with it.
+     * @param query words separated by spaces or punctuation
+     * @param first day ordinal of the first date of the range
+     * @param last day ordinal of the last date of the range (included)
+     * @return handles of the matching events ordered by date
+     */
+    std::vector<EventId> search(const std::string& query, int first, int last) const;
+
+    /**
+     * @brief add_unloaded_day indexes the words of a day whose events
+     * are not loaded yet
+     * @param ordinal day ordinal of the day
+     * @param words words of the names and descriptions of its events
+     */
+    void add_unloaded_day(int ordinal, const std::vector<std::string>& words);
+
+    /**
+     * @brief unloaded_days finds the days added with add_unloaded_day()
+     * that have every word of the query, so their events may match it.
+     * Loading a day does not remove it from this index.
+     * @return day ordinals in the range, ordered
+     */
+    std::vector<int> unloaded_days(const std::string& query, int first, int last) const;
+
+    /**
+     * @brief text_matches tells if the texts have every word of the query,
+     * e.g. to check a series of events without indexing it
+     */
+    static bool text_matches(const std::string& query, std::string_view name,
+                             std::string_view description);
+
+    // removes everything from the index
+    void clear();
+
+private:
+    struct Posting
+    {
+        int ordinal;
+        EventId id;
+
+        bool operator<(const Posting& other) const;
+    };
+    using PostingList = std::set<Posting>;
+
+    struct QueryWord
+    {
+        std::string word;
+        // true if the word ends with '*'
+        bool prefix;
+    };
+
+    // posting lists ordered by word, so words with a prefix are adjacent
+    std::map<std::string, PostingList> postings_;
+    // posting lists of the words of each interned text
+    std::unordered_map<const std::string*, std::vector<PostingList*>> text_words_;
+    // days of each word in events that are not loaded
+    std::map<std::string, std::set<int>> day_postings_;
+
+    // splits a query to its words
+    static std::vector<QueryWord> parse_query(const std::string& query);
+
+    // posting lists of the words of an event, each list once
+    std::vector<PostingList*> lists_of(const Event& event);
+    const std::vector<PostingList*>& lists_of(const std::string& text);
+    // matches of one query word in the range, ordered
+    std::vector<Posting> matches(const std::string& word, bool prefix,
+                                 int first, int last) const;
+};
+
+/**
+ * @brief split_words splits a text to lowercase words
+ * @param text the text to split
+ * @return the words in the order they appear
+ */
+std::vector<std::string> split_words(std::string_view text);
+
+#endif // SEARCHINDEX_HH
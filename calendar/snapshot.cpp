@@ -0,0 +1,406 @@
+#include "snapshot.hh"
+#include "dayordinal.hh"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+const char MAGIC[8] = {'C', 'A', 'L', 'S', 'N', 'A', 'P', '\0'};
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t day_count;
+    uint32_t string_count;
+    uint32_t epoch;
+    uint64_t string_table_offset;
+    // version 2
+    uint32_t series_count;
+    uint32_t exception_count;
+    uint64_t series_offset;
+};
+
+// version 1 headers end before the series count
+const size_t HEADER_V1_SIZE = offsetof(SnapshotHeader, series_count);
+
+struct SnapshotDay
+{
+    int32_t ordinal;
+    uint32_t event_count;
+    uint64_t offset;
+};
+
+struct SnapshotRecord
+{
+    int32_t start;
+    int32_t end;
+    uint32_t name;
+    uint32_t description;
+};
+
+struct SnapshotSeries
+{
+    int32_t first_ordinal;
+    int32_t start;
+    int32_t end;
+    uint32_t name;
+    uint32_t description;
+    int32_t frequency;
+    int32_t interval;
+    int32_t count;
+    int32_t has_until;
+    int32_t until;
+    uint32_t exception_count;
+    uint32_t first_exception;
+};
+
+/* Appends the raw bytes of a value to the buffer. */
+template <typename T>
+void append(string& buffer, const T& value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/* Writes the whole buffer to the file descriptor. */
+bool write_all(int fd, const string& buffer)
+{
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t result = ::write(fd, buffer.data() + written, buffer.size() - written);
+        if (result < 0)
+            return false;
+        written += result;
+    }
+    return true;
+}
+
+/* Makes a rename in the directory of the file durable. */
+bool sync_directory(const string& file_name)
+{
+    size_t slash = file_name.rfind('/');
+    string directory = slash == string::npos ? "." : file_name.substr(0, slash + 1);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+}
+
+bool write_snapshot(const string& file_name, const map<int, DayEvents>& days,
+                    const EventPool& pool, uint32_t epoch,
+                    const vector<Recurrence>& series,
+                    const function<bool(EventId)>& is_stored)
+{
+    // every distinct string is stored once, interned strings
+    // are equal exactly when their addresses are
+    unordered_map<const string*, uint32_t> string_ids;
+    vector<const string*> strings;
+    auto string_id = [&](const string& text)
+    {
+        pair<unordered_map<const string*, uint32_t>::iterator, bool> inserted =
+            string_ids.insert({&text, (uint32_t)strings.size()});
+        if (inserted.second)
+            strings.push_back(&text);
+        return inserted.first->second;
+    };
+
+    // days without stored events are not written
+    auto stored_events = [&is_stored](const DayEvents& day)
+    {
+        if (!is_stored)
+            return day.size();
+        int stored = 0;
+        for (const DayEntry& entry : day)
+        {
+            if (is_stored(entry.id))
+                stored++;
+        }
+        return stored;
+    };
+    uint64_t event_count = 0;
+    uint64_t day_count = 0;
+    for (const pair<const int, DayEvents>& day : days)
+    {
+        int stored = stored_events(day.second);
+        event_count += stored;
+        if (stored > 0)
+            day_count++;
+    }
+
+    // events are written right after the header and the day index
+    uint64_t offset = sizeof(SnapshotHeader) + day_count * sizeof(SnapshotDay);
+    string day_index;
+    string events;
+    day_index.reserve(day_count * sizeof(SnapshotDay));
+    events.reserve(event_count * sizeof(SnapshotRecord));
+    for (const pair<const int, DayEvents>& day : days)
+    {
+        int stored = stored_events(day.second);
+        if (stored == 0)
+            continue;
+
+        append(day_index, SnapshotDay{day.first, (uint32_t)stored,
+                                      offset + events.size()});
+        for (const DayEntry& entry : day.second)
+        {
+            if (is_stored && !is_stored(entry.id))
+                continue;
+            const Event& event = pool.get(entry.id);
+            append(events, SnapshotRecord{event.start(), event.end(),
+                                          string_id(event.name()),
+                                          string_id(event.description())});
+        }
+    }
+
+    string series_records;
+    string exceptions;
+    for (const Recurrence& recurrence : series)
+    {
+        const RecurrenceRule& rule = recurrence.rule();
+        append(series_records, SnapshotSeries{
+            recurrence.first_ordinal(), recurrence.start(), recurrence.end(),
+            string_id(recurrence.name()), string_id(recurrence.description()),
+            (int32_t)rule.frequency, rule.interval, rule.count, rule.has_until,
+            rule.has_until ? day_ordinal(rule.until) : 0,
+            (uint32_t)recurrence.exceptions().size(),
+            (uint32_t)(exceptions.size() / sizeof(int32_t))});
+        for (int ordinal : recurrence.exceptions())
+        {
+            append(exceptions, (int32_t)ordinal);
+        }
+    }
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.day_count = day_index.size() / sizeof(SnapshotDay);
+    header.string_count = strings.size();
+    header.epoch = epoch;
+    header.series_count = series.size();
+    header.exception_count = exceptions.size() / sizeof(int32_t);
+    header.series_offset = sizeof(SnapshotHeader) + day_index.size() + events.size();
+    header.string_table_offset = header.series_offset + series_records.size() +
+                                 exceptions.size();
+
+    string string_table;
+    uint64_t string_offset = 0;
+    for (const string* text : strings)
+    {
+        append(string_table, string_offset);
+        string_offset += text->size();
+    }
+    append(string_table, string_offset);
+    for (const string* text : strings)
+    {
+        string_table += *text;
+    }
+
+    string header_bytes;
+    append(header_bytes, header);
+
+    // write to a temporary file and rename it over the old snapshot
+    string temp_name = file_name + ".tmp";
+    int fd = ::open(temp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    bool ok = write_all(fd, header_bytes) && write_all(fd, day_index) &&
+              write_all(fd, events) && write_all(fd, series_records) &&
+              write_all(fd, exceptions) && write_all(fd, string_table) &&
+              ::fsync(fd) == 0;
+    ::close(fd);
+
+    if (!ok || ::rename(temp_name.c_str(), file_name.c_str()) != 0)
+    {
+        ::unlink(temp_name.c_str());
+        return false;
+    }
+    // the new name is only durable when the directory is synced
+    return sync_directory(file_name);
+}
+
+SnapshotReader::SnapshotReader()
+{
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    close();
+}
+
+void SnapshotReader::close()
+{
+    if (data_ != nullptr)
+        ::munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool SnapshotReader::open(const string& file_name)
+{
+    close();
+
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat file_info;
+    if (::fstat(fd, &file_info) != 0 || file_info.st_size < (off_t)HEADER_V1_SIZE)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = ::mmap(nullptr, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+    data_ = static_cast<const char*>(mapping);
+    size_ = file_info.st_size;
+
+    SnapshotHeader header = {};
+    memcpy(&header, data_, HEADER_V1_SIZE);
+    day_index_offset_ = HEADER_V1_SIZE;
+    if (header.version >= 2 && size_ >= sizeof(SnapshotHeader))
+    {
+        memcpy(&header, data_, sizeof(header));
+        day_index_offset_ = sizeof(SnapshotHeader);
+    }
+    day_count_ = header.day_count;
+    string_count_ = header.string_count;
+    epoch_ = header.epoch;
+    string_table_offset_ = header.string_table_offset;
+    series_count_ = header.series_count;
+    exception_count_ = header.exception_count;
+    series_offset_ = header.series_offset;
+
+    // check that every part of the file fits in it
+    uint64_t index_end = day_index_offset_ + (uint64_t)day_count_ * sizeof(SnapshotDay);
+    uint64_t series_end = series_offset_ + (uint64_t)series_count_ * sizeof(SnapshotSeries) +
+                          (uint64_t)exception_count_ * sizeof(int32_t);
+    uint64_t table_end = string_table_offset_ + ((uint64_t)string_count_ + 1) * sizeof(uint64_t);
+    bool valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header.version >= 1 && header.version <= SNAPSHOT_VERSION &&
+                 day_index_offset_ == (header.version == 1 ? HEADER_V1_SIZE : sizeof(SnapshotHeader)) &&
+                 index_end <= string_table_offset_ && table_end <= size_ &&
+                 (series_count_ == 0 || (series_offset_ >= index_end &&
+                                         series_end <= string_table_offset_));
+    if (valid)
+    {
+        uint64_t last_offset;
+        memcpy(&last_offset, data_ + table_end - sizeof(uint64_t), sizeof(last_offset));
+        valid = table_end + last_offset <= size_;
+    }
+    for (int i = 0; valid && i < (int)day_count_; ++i)
+    {
+        SnapshotDay day;
+        memcpy(&day, data_ + day_index_offset_ + i * sizeof(SnapshotDay), sizeof(day));
+        valid = day.offset >= index_end &&
+                day.offset + day.event_count * sizeof(SnapshotRecord) <= string_table_offset_;
+    }
+    for (int i = 0; valid && i < (int)series_count_; ++i)
+    {
+        SnapshotSeries series;
+        memcpy(&series, data_ + series_offset_ + i * sizeof(SnapshotSeries), sizeof(series));
+        valid = (uint64_t)series.first_exception + series.exception_count <= exception_count_;
+    }
+
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+uint32_t SnapshotReader::epoch() const
+{
+    return epoch_;
+}
+
+int SnapshotReader::day_count() const
+{
+    return day_count_;
+}
+
+int SnapshotReader::day_ordinal(int index) const
+{
+    SnapshotDay day;
+    memcpy(&day, data_ + day_index_offset_ + index * sizeof(SnapshotDay), sizeof(day));
+    return day.ordinal;
+}
+
+string_view SnapshotReader::string_at(uint32_t id) const
+{
+    if (id >= string_count_)
+        return string_view();
+
+    uint64_t offsets[2];
+    memcpy(offsets, data_ + string_table_offset_ + id * sizeof(uint64_t), sizeof(offsets));
+    uint64_t strings_offset = string_table_offset_ + (string_count_ + 1) * sizeof(uint64_t);
+    if (offsets[1] < offsets[0] || strings_offset + offsets[1] > size_)
+        return string_view();
+
+    const char* strings = data_ + strings_offset;
+    return string_view(strings + offsets[0], offsets[1] - offsets[0]);
+}
+
+vector<SnapshotEvent> SnapshotReader::read_day(int index) const
+{
+    SnapshotDay day;
+    memcpy(&day, data_ + day_index_offset_ + index * sizeof(SnapshotDay), sizeof(day));
+
+    vector<SnapshotEvent> events;
+    events.reserve(day.event_count);
+    for (uint32_t i = 0; i < day.event_count; ++i)
+    {
+        SnapshotRecord record;
+        memcpy(&record, data_ + day.offset + i * sizeof(SnapshotRecord), sizeof(record));
+        events.push_back({record.start, record.end, string_at(record.name),
+                          string_at(record.description)});
+    }
+    return events;
+}
+
+int SnapshotReader::series_count() const
+{
+    return series_count_;
+}
+
+Recurrence SnapshotReader::read_series(int index) const
+{
+    SnapshotSeries record;
+    memcpy(&record, data_ + series_offset_ + index * sizeof(SnapshotSeries), sizeof(record));
+
+    RecurrenceRule rule;
+    rule.frequency = (Frequency)record.frequency;
+    rule.interval = record.interval;
+    rule.count = record.count;
+    rule.has_until = record.has_until != 0;
+    if (rule.has_until)
+        rule.until = date_from_ordinal(record.until);
+    Recurrence series(date_from_ordinal(record.first_ordinal), string(string_at(record.name)),
+                      record.start, record.end, string(string_at(record.description)), rule);
+
+    const char* exceptions = data_ + series_offset_ + series_count_ * sizeof(SnapshotSeries);
+    for (uint32_t i = 0; i < record.exception_count; ++i)
+    {
+        int32_t ordinal;
+        memcpy(&ordinal, exceptions + (record.first_exception + i) * sizeof(int32_t),
+               sizeof(ordinal));
+        series.add_exception(ordinal);
+    }
+    return series;
+}
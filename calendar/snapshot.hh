@@ -0,0 +1,145 @@
+/*
+ * Binary snapshot of calendar events.
+ *
+ * A snapshot file has a header, an index of days (sorted by
+ * day ordinal), the fixed size event records of each day in
+ * time order, the repeating series with their exceptions and a
+ * string table holding every distinct event name and
+ * description once:
+ *
+ *   header:     magic "CALSNAP", version, day count, string count,
+ *               epoch, string table offset, series count,
+ *               exception count, series offset
+ *   days:       { ordinal, event count, offset of first event }
+ *   events:     { start, end, name string id, description string id }
+ *   series:     { first ordinal, start, end, name and description
+ *                 string ids, rule, exception count, first exception }
+ *   exceptions: ordinals of the left out occurrences
+ *   strings:    string count + 1 offsets followed by the string bytes
+ *
+ * Version 1 files have no series and end their header before the
+ * series count, they are still read.
+ *
+ * SnapshotReader maps the file to memory and only reads the
+ * header when opened. Events of a day are created when the day
+ * is asked for, so opening even a large snapshot is fast.
+ */
+
+#ifndef SNAPSHOT_HH
+#define SNAPSHOT_HH
+
+#include "dayevents.hh"
+#include "eventpool.hh"
+#include "recurrence.hh"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+const std::uint32_t SNAPSHOT_VERSION = 2;
+
+/**
+ * @brief write_snapshot writes the days to a snapshot file. The file is
+ * first written next to the target and then renamed over it, so a crash
+ * never leaves a half written snapshot behind.
+ * @param file_name path of the snapshot
+ * @param days events of each day keyed by day ordinal
+ * @param pool pool where the events are stored
+ * @param epoch number telling which journal continues this snapshot
+ * @param series repeating events, written with their exceptions
+ * @param is_stored tells which events are written, all if not given
+ * @return false if the file could not be written
+ */
+bool write_snapshot(const std::string& file_name,
+                    const std::map<int, DayEvents>& days,
+                    const EventPool& pool, std::uint32_t epoch,
+                    const std::vector<Recurrence>& series = {},
+                    const std::function<bool(EventId)>& is_stored = nullptr);
+
+// an event read from a snapshot, the texts point to the mapped file
+struct SnapshotEvent
+{
+    Time::Minutes start;
+    Time::Minutes end;
+    std::string_view name;
+    std::string_view description;
+};
+
+class SnapshotReader
+{
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    /**
+     * @brief open maps the snapshot file and checks its header
+     * @param file_name path of the snapshot
+     * @return false if the file is missing, of other version or corrupted
+     */
+    bool open(const std::string& file_name);
+
+    /**
+     * @brief epoch
+     * @return epoch the snapshot was written with
+     */
+    std::uint32_t epoch() const;
+
+    /**
+     * @brief day_count
+     * @return amount of days stored in the snapshot
+     */
+    int day_count() const;
+
+    /**
+     * @brief day_ordinal
+     * @param index 0-based index of the day in the snapshot
+     * @return day ordinal of the day
+     */
+    int day_ordinal(int index) const;
+
+    /**
+     * @brief read_day reads the events of a day
+     * @param index 0-based index of the day in the snapshot
+     * @return events of the day in time order, valid as long as the reader
+     */
+    std::vector<SnapshotEvent> read_day(int index) const;
+
+    /**
+     * @brief series_count
+     * @return amount of repeating series stored in the snapshot
+     */
+    int series_count() const;
+
+    /**
+     * @brief read_series reads a series with its exceptions
+     * @param index 0-based index of the series, which is also its id
+     * @return the series
+     */
+    Recurrence read_series(int index) const;
+
+private:
+    // gives the string with the id from the string table
+    std::string_view string_at(std::uint32_t id) const;
+    // releases the mapping
+    void close();
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint32_t day_count_ = 0;
+    std::uint32_t string_count_ = 0;
+    std::uint32_t epoch_ = 0;
+    std::uint64_t string_table_offset_ = 0;
+    // the day index starts right after the header
+    std::uint64_t day_index_offset_ = 0;
+    std::uint32_t series_count_ = 0;
+    std::uint32_t exception_count_ = 0;
+    std::uint64_t series_offset_ = 0;
+};
+
+#endif // SNAPSHOT_HH
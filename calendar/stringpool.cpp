@@ -0,0 +1,72 @@
+#include "stringpool.hh"
+
+using namespace std;
+
+const string* StringPool::intern(string_view text)
+{
+    unordered_map<string_view, Pooled>::iterator iter = lookup_.find(text);
+    if (iter != lookup_.end())
+    {
+        iter->second.users++;
+        return iter->second.text;
+    }
+
+    string* pooled = nullptr;
+    if (!free_strings_.empty())
+    {
+        pooled = free_strings_.back();
+        free_strings_.pop_back();
+        pooled->assign(text);
+    }
+    else
+    {
+        strings_.emplace_back(text);
+        pooled = &strings_.back();
+    }
+    lookup_.insert({string_view(*pooled), Pooled{pooled, 1}});
+    return pooled;
+}
+
+/* A freed string gives its memory back right away, only the empty
+ * string object waits to be reused.
+ */
+bool StringPool::release(const string* text)
+{
+    unordered_map<string_view, Pooled>::iterator iter = lookup_.find(*text);
+    if (iter == lookup_.end() || iter->second.text != text || --iter->second.users > 0)
+        return false;
+
+    string* freed = iter->second.text;
+    lookup_.erase(iter);
+    string().swap(*freed);
+    free_strings_.push_back(freed);
+    return true;
+}
+
+bool StringPool::contains(const string* text) const
+{
+    unordered_map<string_view, Pooled>::const_iterator iter = lookup_.find(*text);
+    return iter != lookup_.end() && iter->second.text == text;
+}
+
+int StringPool::size() const
+{
+    return (int)lookup_.size();
+}
+
+size_t StringPool::bytes() const
+{
+    size_t total = strings_.size() * sizeof(string);
+    for (const string& text : strings_)
+    {
+        // short strings are kept inside the string object itself
+        const char* object = reinterpret_cast<const char*>(&text);
+        if (text.data() < object || text.data() >= object + sizeof(string))
+            total += text.capacity() + 1;
+    }
+    // hash table nodes and buckets
+    total += lookup_.size() * (sizeof(pair<string_view, Pooled>) + sizeof(void*));
+    total += lookup_.bucket_count() * sizeof(void*);
+    total += free_strings_.capacity() * sizeof(string*);
+    return total;
+}
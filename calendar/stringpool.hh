@@ -0,0 +1,74 @@
+/*
+ * StringPool stores each distinct string only once. Events
+ * with the same name or description (like "Standup") share
+ * the same string instead of every event having its own copy.
+ *
+ * Each string counts its users. Interned strings are never
+ * moved, so pointers to them stay valid until the last user
+ * releases the string. The memory of a freed string is reused
+ * for later strings, so a pointer to it may then point to
+ * another text.
+ */
+
+#ifndef STRINGPOOL_HH
+#define STRINGPOOL_HH
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class StringPool
+{
+public:
+    /**
+     * @brief intern gives the pooled copy of the text, adding it if needed.
+     * Each call adds a user to the string.
+     * @param text the text to look for
+     * @return pointer to the pooled string, valid until its users release it
+     */
+    const std::string* intern(std::string_view text);
+
+    /**
+     * @brief release removes a user of a pooled string, the string is
+     * freed when it has no users left
+     * @param text pointer returned by intern
+     * @return true if the string was freed
+     */
+    bool release(const std::string* text);
+
+    /**
+     * @brief contains
+     * @return true if the pointer is of a string that is not freed
+     */
+    bool contains(const std::string* text) const;
+
+    /**
+     * @brief size
+     * @return amount of distinct strings in the pool
+     */
+    int size() const;
+
+    /**
+     * @brief bytes
+     * @return estimated memory used by the pool in bytes
+     */
+    std::size_t bytes() const;
+
+private:
+    struct Pooled
+    {
+        std::string* text;
+        int users;
+    };
+
+    // deque never moves its elements, so views to them stay valid
+    std::deque<std::string> strings_;
+    // strings that are freed and can be used for new texts
+    std::vector<std::string*> free_strings_;
+    std::unordered_map<std::string_view, Pooled> lookup_;
+};
+
+#endif // STRINGPOOL_HH
@@ -0,0 +1,458 @@
+#include <QtTest>
+#include "../calendar.hh"
+#include "../concurrentcalendar.hh"
+#include "../bufferedwriter.hh"
+#include "../dayordinal.hh"
+#include "../freebusy.hh"
+#include "../calendarserver.hh"
+#include "../loadgenerator.hh"
+#include "../date.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Benchmarks of the calendar. Run with -csv (or -xml, -junitxml) to get
+// machine-readable results, e.g. -o results.csv,csv. The scale benchmarks
+// go from 10^3 events up to CALENDAR_BENCH_MAX_EVENTS (default 10^6,
+// set it to 10000000 for the largest runs).
+
+// amount of events changed or read by one benchmark run
+const int OPERATIONS = 1000;
+class calendar_bench : public QObject
+{
+    Q_OBJECT
+
+public:
+    calendar_bench();
+    ~calendar_bench();
+
+private slots:
+
+    // Benchmark 1: the same work split over 1..N threads (data-driven)
+    void concurrent_scaling_data();
+    void concurrent_scaling();
+
+    // Benchmark 2: adding events one at a time
+    void add_event_data();
+    void add_event();
+
+    // Benchmark 3: deleting events from random days
+    void delete_event_data();
+    void delete_event();
+
+    // Benchmark 4: moving events between random days
+    void move_event_data();
+    void move_event();
+
+    // Benchmark 5: printing random days
+    void print_day_data();
+    void print_day();
+
+    // Benchmark 6: printing every month of a year
+    void print_month_data();
+    void print_month();
+
+    // Benchmark 7: counting the events of random days
+    void events_count_data();
+    void events_count();
+
+    // Benchmark 8: common free time of hundreds of calendars (data-driven)
+    void free_slots_data();
+    void free_slots();
+
+    // Benchmark 9: requests to the daemon from many clients (data-driven)
+    void daemon_load_data();
+    void daemon_load();
+
+    void cleanup();
+
+private:
+    std::unique_ptr<Calendar> calendar_;
+    std::vector<EventData> events_;
+    // dates that have events, in random order
+    std::vector<Date> dates_;
+
+    // creates the events of the current data row to events_ and dates_
+    void generate_events();
+    // adds the events to a new calendar
+    void fill_calendar();
+};
+
+// rows for the scale benchmarks: amount of events, events per day, order
+static void add_scale_rows()
+{
+    QTest::addColumn<int>("events");
+    QTest::addColumn<int>("per_day");
+    QTest::addColumn<bool>("random_order");
+
+    int max_events = 1000000;
+    if (const char* max = std::getenv("CALENDAR_BENCH_MAX_EVENTS"))
+        max_events = std::atoi(max);
+
+    for (int events = 1000; events <= max_events; events *= 10)
+    {
+        for (int per_day : {1, 32, 1024})
+        {
+            if (per_day > events)
+                continue;
+            for (bool random_order : {false, true})
+            {
+                QTest::newRow(qPrintable(QString("%1 events, %2/day, %3")
+                                         .arg(events).arg(per_day)
+                                         .arg(random_order ? "random" : "sorted")))
+                    << events << per_day << random_order;
+            }
+        }
+    }
+}
+
+// output of the print benchmarks goes to /dev/null without a write per line
+class DiscardOutput
+{
+public:
+    DiscardOutput():
+        fd_(::open("/dev/null", O_WRONLY)), writer_(fd_),
+        old_output_(std::cout.rdbuf(&writer_)) {}
+    ~DiscardOutput()
+    {
+        std::cout.rdbuf(old_output_);
+        writer_.flush();
+        ::close(fd_);
+    }
+
+private:
+    int fd_;
+    BufferedWriter writer_;
+    std::streambuf* old_output_;
+};
+
+calendar_bench::calendar_bench() {}
+
+calendar_bench::~calendar_bench() {}
+
+void calendar_bench::cleanup()
+{
+    calendar_.reset();
+    events_.clear();
+    dates_.clear();
+}
+
+/* Spreads the events evenly over the day, per_day events on each date
+ * starting from 1.1.2000. Sorted order adds them by date and time.
+ */
+void calendar_bench::generate_events()
+{
+    QFETCH(int, events);
+    QFETCH(int, per_day);
+    QFETCH(bool, random_order);
+
+    int first = day_ordinal(1, 1, 2000);
+    int days = (events + per_day - 1) / per_day;
+    Time::Minutes step = std::max(1, (DAY_END - 60) / per_day);
+
+    events_.clear();
+    events_.reserve(events);
+    for (int i = 0; i < events; ++i)
+    {
+        Time::Minutes start = (i % per_day) * step;
+        events_.push_back({date_from_ordinal(first + i / per_day), "Event",
+                           start, start + 60, "Description"});
+    }
+
+    dates_.clear();
+    for (int day = 0; day < days; ++day)
+        dates_.push_back(date_from_ordinal(first + day));
+
+    // the same seed gives the same order on every run
+    std::mt19937 random(42);
+    if (random_order)
+        std::shuffle(events_.begin(), events_.end(), random);
+    std::shuffle(dates_.begin(), dates_.end(), random);
+}
+
+void calendar_bench::fill_calendar()
+{
+    calendar_ = std::make_unique<Calendar>();
+    calendar_->add_events(events_);
+}
+
+// Benchmark 1
+void calendar_bench::concurrent_scaling_data()
+{
+    QTest::addColumn<int>("threads");
+
+    // powers of two up to the amount of cores, and the cores themselves
+    int cores = std::max(1, QThread::idealThreadCount());
+    for (int threads = 1; threads < cores; threads *= 2)
+        QTest::newRow(qPrintable(QString("%1 threads").arg(threads))) << threads;
+    QTest::newRow(qPrintable(QString("%1 threads").arg(cores))) << cores;
+}
+
+void calendar_bench::concurrent_scaling()
+{
+    QFETCH(int, threads);
+
+    // 90 % reads and 10 % adds spread over the months of two years
+    const int operations = 200000;
+    ConcurrentCalendar calendar;
+    for (int i = 0; i < 20000; ++i)
+        calendar.add_event("Event", i % 1400, i % 1400 + 30, "", Date(1 + i % 28, 1 + i % 12, 2024));
+
+    // run once, so every thread count starts from the same calendar
+    // instead of one grown by the adds of earlier iterations
+    QBENCHMARK_ONCE {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&calendar, threads, operations, t]()
+            {
+                for (int i = t; i < operations; i += threads)
+                {
+                    Date date(1 + i % 28, 1 + i / 28 % 12, 2024 + i % 2);
+                    if (i % 10 == 0)
+                        calendar.add_event("Added", i % 1400, i % 1400 + 10, "", date);
+                    else if (i % 10 == 1)
+                        calendar.events_on(date);
+                    else
+                        calendar.events_count(date);
+                }
+            });
+        }
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+}
+
+// Benchmark 2
+void calendar_bench::add_event_data()
+{
+    add_scale_rows();
+}
+
+void calendar_bench::add_event()
+{
+    generate_events();
+    calendar_ = std::make_unique<Calendar>();
+
+    QBENCHMARK_ONCE {
+        for (const EventData& event : events_)
+        {
+            calendar_->add_event(event.name, event.start, event.end,
+                                 event.description, event.date);
+        }
+    }
+}
+
+// Benchmark 3
+void calendar_bench::delete_event_data()
+{
+    add_scale_rows();
+}
+
+void calendar_bench::delete_event()
+{
+    generate_events();
+    fill_calendar();
+
+    // the middle event of each day, going through the days again if needed
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < OPERATIONS; ++i)
+        {
+            Date date = dates_.at(i % dates_.size());
+            calendar_->change_date(date);
+            calendar_->delete_event(calendar_->events_count(date) / 2 + 1);
+        }
+    }
+}
+
+// Benchmark 4
+void calendar_bench::move_event_data()
+{
+    add_scale_rows();
+}
+
+void calendar_bench::move_event()
+{
+    generate_events();
+    fill_calendar();
+
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < OPERATIONS; ++i)
+        {
+            Date date = dates_.at(i % dates_.size());
+            calendar_->change_date(date);
+            calendar_->move_event(calendar_->events_count(date) / 2 + 1,
+                                  dates_.at((i + 1) % dates_.size()));
+        }
+    }
+}
+
+// Benchmark 5
+void calendar_bench::print_day_data()
+{
+    add_scale_rows();
+}
+
+void calendar_bench::print_day()
+{
+    generate_events();
+    fill_calendar();
+    DiscardOutput discard;
+
+    QBENCHMARK {
+        for (int i = 0; i < OPERATIONS; ++i)
+        {
+            calendar_->change_date(dates_.at(i % dates_.size()));
+            calendar_->print_day();
+        }
+    }
+}
+
+// Benchmark 6
+void calendar_bench::print_month_data()
+{
+    add_scale_rows();
+}
+
+void calendar_bench::print_month()
+{
+    generate_events();
+    fill_calendar();
+    DiscardOutput discard;
+
+    QBENCHMARK {
+        for (int month = 1; month <= 12; ++month)
+        {
+            calendar_->change_date(Date(1, month, 2000));
+            calendar_->print_month();
+        }
+    }
+}
+
+// Benchmark 7
+void calendar_bench::events_count_data()
+{
+    add_scale_rows();
+}
+
+void calendar_bench::events_count()
+{
+    generate_events();
+    fill_calendar();
+
+    int total = 0;
+    QBENCHMARK {
+        for (int i = 0; i < OPERATIONS; ++i)
+            total += calendar_->events_count(dates_.at(i % dates_.size()));
+    }
+    QVERIFY(total > 0);
+}
+
+// Benchmark 8
+void calendar_bench::free_slots_data()
+{
+    QTest::addColumn<int>("calendars");
+    QTest::addColumn<int>("threads");
+
+    int cores = std::max(1, QThread::idealThreadCount());
+    for (int calendars : {100, 400, 1000})
+    {
+        QTest::newRow(qPrintable(QString("%1 calendars, 1 thread").arg(calendars)))
+            << calendars << 1;
+        if (cores > 1)
+        {
+            QTest::newRow(qPrintable(QString("%1 calendars, %2 threads")
+                                     .arg(calendars).arg(cores)))
+                << calendars << cores;
+        }
+    }
+}
+
+void calendar_bench::free_slots()
+{
+    QFETCH(int, calendars);
+    QFETCH(int, threads);
+
+    // a working week of each person with eight meetings a day
+    int first = day_ordinal(1, 1, 2024);
+    std::vector<std::unique_ptr<Calendar>> owned;
+    std::vector<Calendar*> people;
+    std::mt19937 random(42);
+    for (int person = 0; person < calendars; ++person)
+    {
+        owned.push_back(std::make_unique<Calendar>());
+        std::vector<EventData> meetings;
+        for (int day = 0; day < 5; ++day)
+        {
+            for (int meeting = 0; meeting < 8; ++meeting)
+            {
+                Time::Minutes start = 8 * 60 + random() % (10 * 60);
+                meetings.push_back({date_from_ordinal(first + day), "Meeting",
+                                    start, start + 30, ""});
+            }
+        }
+        owned.back()->add_events(meetings);
+        people.push_back(owned.back().get());
+    }
+
+    QBENCHMARK {
+        common_free_slots(people, date_from_ordinal(first), date_from_ordinal(first + 6),
+                          30, threads);
+    }
+}
+
+// Benchmark 9
+void calendar_bench::daemon_load_data()
+{
+    QTest::addColumn<int>("clients");
+    QTest::addColumn<int>("pipeline");
+
+    for (int clients : {1, 8, 32})
+    {
+        for (int pipeline : {1, 32})
+        {
+            QTest::newRow(qPrintable(QString("%1 clients, pipeline %2")
+                                     .arg(clients).arg(pipeline)))
+                << clients << pipeline;
+        }
+    }
+}
+
+void calendar_bench::daemon_load()
+{
+    QFETCH(int, clients);
+    QFETCH(int, pipeline);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    LoadOptions options;
+    options.socket_path = directory.filePath("calendar.sock").toStdString();
+    options.clients = clients;
+    options.requests = OPERATIONS * 10;
+    options.pipeline = pipeline;
+
+    CalendarServer server;
+    QVERIFY(server.listen(options.socket_path));
+    std::thread loop([&server] { server.run(); });
+
+    LoadResult result;
+    QBENCHMARK_ONCE {
+        result = generate_load(options);
+    }
+    server.stop();
+    loop.join();
+
+    QCOMPARE(result.broken_clients, 0);
+    qDebug("%.0f requests/s, latency p50 %.0f us, p99 %.0f us",
+           result.requests_per_second(), result.p50_us, result.p99_us);
+}
+
+QTEST_APPLESS_MAIN(calendar_bench)
+
+#include "tst_calendar_bench.moc"
@@ -1,167 +1,1325 @@
-#include <QtTest>
-#include "../calendar.hh"
-#include "../date.hh"
-#include "../time.hh"
-#include "../event.hh"
-#include <memory>
-
-// add necessary includes here
-
-class calendar_test : public QObject
-{
-    Q_OBJECT
-
-public:
-    calendar_test();
-    ~calendar_test();
-
-private slots:
-
-    // Test 1: change date
-    void changeDate_changesChosenDate();
-
-    // Test 2: create & delete events
-    void create_and_delete_event();
-
-    // Test 3: testing calendar functionality with inputs (data-driven)
-    void calendar_testing_data();
-    void calendar_testing();
-
-private:
-    std::shared_ptr<Calendar> calendar_;
-};
-
-calendar_test::calendar_test() {}
-
-calendar_test::~calendar_test() {}
-
-// Test 1
-void calendar_test::changeDate_changesChosenDate()
-{
-    // create a new calendar
-    calendar_.reset();
-    calendar_ = make_shared<Calendar>();
-
-    // create dates
-    Date date1(1, 1, 2000);
-    Date date2(13, 9, 2024);
-
-    // change calendars date to d1 and compate with d1
-    calendar_->change_date(date1);   // or whatever your function returns
-    QVERIFY2(calendar_->chosen_date() == date1, "Method date is wrong when comparing it to date1");
-
-    // change calendars date to d1 and compate with d1
-    calendar_->change_date(date2);
-    QVERIFY2(calendar_->chosen_date() == date2, "Method date is wrong when comparing it to date2");
-
-    // if both succeed, means that change_date works correctly
-}
-
-// Test 2
-void calendar_test::create_and_delete_event()
-{
-    // create a new calendar
-    calendar_.reset();
-    calendar_ = make_shared<Calendar>();
-
-    Date date1(1, 1, 2000);
-    Time::Minutes start_time(120);
-    Time::Minutes end_time(160);
-
-    calendar_->change_date(date1);
-    // check if day has events
-    QCOMPARE(calendar_->events_count(date1), 0);
-
-    // add event with wrong parameters (end time > start time)
-    // this should print (Error: wrong times) in the console (comes from the calendar.hh)
-    calendar_->add_event("Test event", end_time, start_time, "This is a test event");
-    // check event amount. Should be 0
-    QCOMPARE(calendar_->events_count(date1), 0);
-
-    // add event with correct parameters
-    bool event_added = calendar_->add_event("Test event", start_time, end_time, "This is a test event");
-    QVERIFY2(event_added, "Event could not be added");
-    // compare events amount. Should be 1
-    QCOMPARE(calendar_->events_count(date1), 1);
-
-    // delete event
-    bool deleted = calendar_->delete_event(1);
-    QVERIFY2(deleted, "Event could not be deleted");
-    QVERIFY2(calendar_->events_count(date1) == 0,
-             "Event count after deletion is not 0! Event deletion failed.");
-}
-
-// Test 3
-void calendar_test::calendar_testing_data()
-{
-    // create a new calendar
-    calendar_.reset();
-    calendar_ = std::make_shared<Calendar>();
-
-
-    QTest::addColumn<QString>("event_name");
-    QTest::addColumn<int>("time1");
-    QTest::addColumn<int>("time2");
-    QTest::addColumn<QString>("event_description");
-    QTest::addColumn<int>("expected_amount_of_events");
-    // the expected result of event (correct/incorrect)
-    QTest::addColumn<bool>("successful");
-
-
-    // create first event Event(name, time1, time2, description)
-    QTest::newRow("Create first event")
-        << QString("Test event")
-        << 600
-        << 660
-        << QString("this is just a test")
-        << 1
-        << true;
-
-    // create second event starting earlier
-    QTest::newRow("Create second event that should become the earliest event")
-        << QString("Earlier event")
-        << 500
-        << 800
-        << QString("this event should be the first one")
-        << 2
-        << true;
-
-
-    // create third event with incorrect parameters
-    // this should print (Error: wrong times) in the console (comes from the calendar.hh)
-    QTest::newRow("Create third event which has incorrect parameters")
-        << QString("My birthday")
-        << 100
-        << 10
-        << QString("this event is incorrect")
-        << 2
-        << false;
-}
-void calendar_test::calendar_testing()
-{
-    Date d(1,1,1999);
-    calendar_->change_date(d);
-
-    QFETCH(QString, event_name);
-    QFETCH(int, time1);
-    QFETCH(int, time2);
-    QFETCH(QString, event_description);
-    QFETCH(int, expected_amount_of_events);
-    QFETCH(bool, successful);
-
-    // create an event
-    bool event_added = calendar_->add_event(event_name.toStdString(),
-                                            Time::Minutes(time1),
-                                            Time::Minutes(time2),
-                                            event_description.toStdString());
-
-    // check if event was created as required
-    QVERIFY2(event_added == successful, "Event creation was incorrect.");
-    // compare events amount to the expected amount
-    QCOMPARE(calendar_->events_count(calendar_->chosen_date()), expected_amount_of_events);
-
-}
-
-QTEST_APPLESS_MAIN(calendar_test)
-
-#include "tst_calendar_test.moc"
+#include <QtTest>
+#include "../calendar.hh"
+#include "../date.hh"
+#include "../time.hh"
+#include "../event.hh"
+#include "../stringpool.hh"
+#include "../icsimporter.hh"
+#include "../bufferedwriter.hh"
+#include "../concurrentcalendar.hh"
+#include "../dayordinal.hh"
+#include "../freebusy.hh"
+#include "../calendarserver.hh"
+#include "../calendarclient.hh"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+// add necessary includes here
+
+class calendar_test : public QObject
+{
+    Q_OBJECT
+
+public:
+    calendar_test();
+    ~calendar_test();
+
+private slots:
+
+    // Test 1: change date
+    void changeDate_changesChosenDate();
+
+    // Test 2: create & delete events
+    void create_and_delete_event();
+
+    // Test 3: testing calendar functionality with inputs (data-driven)
+    void calendar_testing_data();
+    void calendar_testing();
+
+    // Test 4: adding many events at once
+    void add_events_addsToEachDate();
+
+    // Test 5: overlap and free time queries
+    void overlaps_and_free_slots();
+
+    // Test 6: events of a date range
+    void events_in_range_isOrdered();
+
+    // Test 7: importing a generated .ics file
+    void ics_import_data();
+    void ics_import();
+
+    // Test 8: saving and loading a snapshot
+    void snapshot_roundTrip();
+
+    // Test 9: replaying the journal after a crash
+    void journal_replay();
+
+    // Test 10: repeating events
+    void recurring_events();
+
+    // Test 11: handles of events and changing many events at once
+    void stable_ids_and_batch_changes();
+
+    // Test 12: buffered output of the batch mode
+    void buffered_writer();
+
+    // Test 13: many threads using the same calendar
+    void concurrent_stress();
+
+    // Test 14: searching events by words
+    void search_words();
+
+    // Test 15: exporting events as JSON Lines and CSV
+    void export_events();
+
+    // Test 16: reminders with a simulated clock
+    void reminders_followChanges();
+
+    // Test 17: common free time of many calendars
+    void free_busy_acrossCalendars();
+
+    // Test 18: undo and redo of single and batch changes
+    void undo_redo();
+
+    // Test 19: archiving old days and loading them back
+    void archive_oldDays();
+
+    // Test 20: pipelined requests to the daemon over a socket
+    void daemon_pipelinedRequests();
+
+private:
+    std::shared_ptr<Calendar> calendar_;
+};
+
+calendar_test::calendar_test() {}
+
+calendar_test::~calendar_test() {}
+
+// Test 1
+void calendar_test::changeDate_changesChosenDate()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    // create dates
+    Date date1(1, 1, 2000);
+    Date date2(13, 9, 2024);
+
+    // change calendars date to d1 and compate with d1
+    calendar_->change_date(date1);   // or whatever your function returns
+    QVERIFY2(calendar_->chosen_date() == date1, "Method date is wrong when comparing it to date1");
+
+    // change calendars date to d1 and compate with d1
+    calendar_->change_date(date2);
+    QVERIFY2(calendar_->chosen_date() == date2, "Method date is wrong when comparing it to date2");
+
+    // if both succeed, means that change_date works correctly
+}
+
+// Test 2
+void calendar_test::create_and_delete_event()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    Date date1(1, 1, 2000);
+    Time::Minutes start_time(120);
+    Time::Minutes end_time(160);
+
+    calendar_->change_date(date1);
+    // check if day has events
+    QCOMPARE(calendar_->events_count(date1), 0);
+
+    // add event with wrong parameters (end time > start time)
+    // this should print (Error: wrong times) in the console (comes from the calendar.hh)
+    calendar_->add_event("Test event", end_time, start_time, "This is a test event");
+    // check event amount. Should be 0
+    QCOMPARE(calendar_->events_count(date1), 0);
+
+    // add event with correct parameters
+    bool event_added = calendar_->add_event("Test event", start_time, end_time, "This is a test event");
+    QVERIFY2(event_added, "Event could not be added");
+    // compare events amount. Should be 1
+    QCOMPARE(calendar_->events_count(date1), 1);
+
+    // delete event
+    bool deleted = calendar_->delete_event(1);
+    QVERIFY2(deleted, "Event could not be deleted");
+    QVERIFY2(calendar_->events_count(date1) == 0,
+             "Event count after deletion is not 0! Event deletion failed.");
+}
+
+// Test 3
+void calendar_test::calendar_testing_data()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = std::make_shared<Calendar>();
+
+
+    QTest::addColumn<QString>("event_name");
+    QTest::addColumn<int>("time1");
+    QTest::addColumn<int>("time2");
+    QTest::addColumn<QString>("event_description");
+    QTest::addColumn<int>("expected_amount_of_events");
+    // the expected result of event (correct/incorrect)
+    QTest::addColumn<bool>("successful");
+
+
+    // create first event Event(name, time1, time2, description)
+    QTest::newRow("Create first event")
+        << QString("Test event")
+        << 600
+        << 660
+        << QString("this is just a test")
+        << 1
+        << true;
+
+    // create second event starting earlier
+    QTest::newRow("Create second event that should become the earliest event")
+        << QString("Earlier event")
+        << 500
+        << 800
+        << QString("this event should be the first one")
+        << 2
+        << true;
+
+
+    // create third event with incorrect parameters
+    // this should print (Error: wrong times) in the console (comes from the calendar.hh)
+    QTest::newRow("Create third event which has incorrect parameters")
+        << QString("My birthday")
+        << 100
+        << 10
+        << QString("this event is incorrect")
+        << 2
+        << false;
+}
+void calendar_test::calendar_testing()
+{
+    Date d(1,1,1999);
+    calendar_->change_date(d);
+
+    QFETCH(QString, event_name);
+    QFETCH(int, time1);
+    QFETCH(int, time2);
+    QFETCH(QString, event_description);
+    QFETCH(int, expected_amount_of_events);
+    QFETCH(bool, successful);
+
+    // create an event
+    bool event_added = calendar_->add_event(event_name.toStdString(),
+                                            Time::Minutes(time1),
+                                            Time::Minutes(time2),
+                                            event_description.toStdString());
+
+    // check if event was created as required
+    QVERIFY2(event_added == successful, "Event creation was incorrect.");
+    // compare events amount to the expected amount
+    QCOMPARE(calendar_->events_count(calendar_->chosen_date()), expected_amount_of_events);
+
+}
+
+// Test 4
+void calendar_test::add_events_addsToEachDate()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    Date date1(1, 1, 2000);
+    Date date2(2, 1, 2000);
+
+    std::vector<EventData> events;
+    events.push_back({date1, "Late", 600, 660, ""});
+    events.push_back({date2, "Other day", 100, 200, ""});
+    events.push_back({date1, "Early", 60, 120, ""});
+    // invalid times, should be skipped
+    events.push_back({date1, "Wrong", 200, 100, ""});
+
+    QCOMPARE(calendar_->add_events(events), 3);
+    QCOMPARE(calendar_->events_count(date1), 2);
+    QCOMPARE(calendar_->events_count(date2), 1);
+    // both days are marked in the month summary
+    QCOMPARE(calendar_->month_summary(1, 2000), std::uint32_t(0b11));
+
+    // single adds after a batch still work
+    calendar_->change_date(date1);
+    QVERIFY(calendar_->add_event("Middle", 300, 400, ""));
+    QCOMPARE(calendar_->events_count(date1), 3);
+
+    // events with the same texts share them
+    calendar_->add_event("Late", 700, 800, "", date2);
+    std::vector<EventId> late1 = calendar_->overlapping(date1, 600, 660);
+    std::vector<EventId> late2 = calendar_->overlapping(date2, 700, 800);
+    QCOMPARE(&calendar_->event(late1.at(0)).name(), &calendar_->event(late2.at(0)).name());
+    QCOMPARE(calendar_->memory_usage().events, 5);
+
+    // a text too long to fit inside its string object is counted
+    StringPool short_text;
+    StringPool long_text;
+    short_text.intern("Short");
+    long_text.intern(std::string(20, 'x'));
+    QCOMPARE(long_text.bytes(), short_text.bytes() + 21);
+}
+
+// Test 5
+void calendar_test::overlaps_and_free_slots()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    Date date1(1, 1, 2000);
+    Date date2(2, 1, 2000);
+    calendar_->add_event("Morning", 60, 120, "", date1);
+    calendar_->add_event("Long", 100, 300, "", date1);
+    calendar_->add_event("Evening", 500, 600, "", date1);
+
+    // 01:50 - 02:10 overlaps both of the first events
+    QCOMPARE((int)calendar_->overlapping(date1, 110, 130).size(), 2);
+    // end times are exclusive
+    QVERIFY(!calendar_->has_conflict(date1, 300, 500));
+    QVERIFY(calendar_->has_conflict(date1, 299, 301));
+
+    Date slot_date;
+    Time::Minutes slot_start = 0;
+    // first free 200 minutes are right after the long event
+    QVERIFY(calendar_->find_free_slot(200, date1, date2, slot_date, slot_start));
+    QVERIFY(slot_date == date1);
+    QCOMPARE(slot_start, Time::Minutes(300));
+
+    // too long for the first day, the empty second day is free
+    QVERIFY(calendar_->find_free_slot(1000, date1, date2, slot_date, slot_start));
+    QVERIFY(slot_date == date2);
+    QVERIFY(!calendar_->find_free_slot(1000, date1, date1, slot_date, slot_start));
+
+    // a long event and many short ones: only the ones at the time overlap
+    Date date3(3, 1, 2000);
+    std::vector<EventData> events = {{date3, "All day", 0, DAY_END, ""}};
+    for (Time::Minutes start = 0; start < DAY_END; ++start)
+        events.push_back({date3, "Short", start, start + 1, ""});
+    calendar_->add_events(events);
+    std::vector<EventId> found = calendar_->overlapping(date3, 1000, 1002);
+    QCOMPARE((int)found.size(), 3);
+    QCOMPARE(calendar_->event(found.at(0)).name(), std::string("All day"));
+    QCOMPARE(calendar_->event(found.at(1)).start(), Time::Minutes(1000));
+    QCOMPARE(calendar_->event(found.at(2)).start(), Time::Minutes(1001));
+    QCOMPARE((int)calendar_->overlapping(date3, 0, DAY_END).size(), DAY_END + 1);
+}
+
+// Test 6
+void calendar_test::events_in_range_isOrdered()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    // range crosses a year boundary
+    calendar_->add_event("Second", 60, 120, "", Date(1, 1, 2001));
+    calendar_->add_event("Outside", 60, 120, "", Date(2, 1, 2001));
+    calendar_->add_event("First late", 300, 400, "", Date(31, 12, 2000));
+    calendar_->add_event("First early", 100, 200, "", Date(31, 12, 2000));
+
+    EventRange range = calendar_->events_in_range(Date(30, 12, 2000), Date(1, 1, 2001));
+    QCOMPARE(range.size(), 3);
+
+    std::vector<std::string> names;
+    for (const Event& event : range)
+    {
+        names.push_back(event.name());
+    }
+    std::vector<std::string> expected = {"First early", "First late", "Second"};
+    QVERIFY(names == expected);
+
+    QVERIFY(calendar_->events_in_range(Date(1, 2, 2001), Date(1, 3, 2001)).empty());
+}
+
+// Test 7
+void calendar_test::ics_import_data()
+{
+    QTest::addColumn<int>("event_amount");
+
+    QTest::newRow("Small file") << 10;
+    QTest::newRow("Large file") << 100000;
+}
+void calendar_test::ics_import()
+{
+    QFETCH(int, event_amount);
+
+    // generate the fixture, events are spread over 28 days of January
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string file_name = directory.filePath("fixture.ics").toStdString();
+    {
+        std::ofstream file(file_name);
+        file << "BEGIN:VCALENDAR\r\nVERSION:2.0\r\n";
+        for (int i = 0; i < event_amount; ++i)
+        {
+            int day = i % 28 + 1;
+            file << "BEGIN:VEVENT\r\n"
+                 << "DTSTART:202401" << (day < 10 ? "0" : "") << day << "T090000\r\n"
+                 << "DTEND:202401" << (day < 10 ? "0" : "") << day << "T093000\r\n"
+                 << "SUMMARY:Standup\\, team " << i % 3 << "\r\n"
+                 << "DESCRIPTION:A long description that is\r\n"
+                 << "  folded to the next line\r\n"
+                 << "END:VEVENT\r\n";
+        }
+        // the texts of an alarm inside an event are not the event's
+        file << "BEGIN:VEVENT\r\nDTSTART:20240201T100000\r\nSUMMARY:Dentist\r\n"
+             << "BEGIN:VALARM\r\nSUMMARY:Alarm\r\nDESCRIPTION:Reminder\r\n"
+             << "END:VALARM\r\nEND:VEVENT\r\n";
+        // an event that is not terminated before the next one begins
+        file << "BEGIN:VEVENT\r\nDTSTART:20240202T100000\r\n";
+        // an event with a broken start date is reported with its line
+        file << "BEGIN:VEVENT\r\nDTSTART:2024XX01\r\nEND:VEVENT\r\n";
+        file << "END:VCALENDAR\r\n";
+    }
+    int unterminated_line = 2 + event_amount * 7 + 8 + 1;
+    int broken_line = unterminated_line + 2 + 1;
+
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+    IcsImporter importer(*calendar_);
+    IcsImportResult result = importer.import_file(file_name);
+
+    QVERIFY(result.file_found);
+    QCOMPARE(result.imported, event_amount + 1);
+    QCOMPARE(result.skipped, 2);
+    QCOMPARE((int)result.errors.size(), 3);
+    QCOMPARE(result.errors.at(0).line, unterminated_line);
+    QCOMPARE(result.errors.at(1).line, broken_line);
+    qInfo() << result.imported << "events in" << result.seconds << "s,"
+            << result.events_per_second() << "events/s";
+
+    QCOMPARE(calendar_->events_count(Date(1, 1, 2024)), (event_amount + 27) / 28);
+    EventRange range = calendar_->events_in_range(Date(1, 1, 2024), Date(1, 1, 2024));
+    QCOMPARE(range.begin()->name(), std::string("Standup, team 0"));
+    QCOMPARE(range.begin()->description(),
+             std::string("A long description that is folded to the next line"));
+
+    range = calendar_->events_in_range(Date(1, 2, 2024), Date(2, 2, 2024));
+    QCOMPARE(range.begin()->name(), std::string("Dentist"));
+    QCOMPARE(range.begin()->description(), std::string(""));
+    QCOMPARE(calendar_->events_count(Date(2, 2, 2024)), 0);
+}
+
+// Test 8
+void calendar_test::snapshot_roundTrip()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    Date date1(1, 1, 2000);
+    Date date2(15, 1, 2000);
+    calendar_->add_event("Standup", 540, 555, "Daily", date1);
+    calendar_->add_event("Standup", 540, 555, "Daily", date2);
+    calendar_->add_event("Review", 600, 660, "Sprint review", date2);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string file_name = directory.filePath("calendar.snap").toStdString();
+    QVERIFY(calendar_->save_snapshot(file_name));
+
+    Calendar loaded;
+    QVERIFY(loaded.load_snapshot(file_name));
+    // month summary is known before any day is loaded
+    QCOMPARE(loaded.month_summary(1, 2000), calendar_->month_summary(1, 2000));
+    QCOMPARE(loaded.events_count(date1), 1);
+    QCOMPARE(loaded.events_count(date2), 2);
+
+    EventRange range = loaded.events_in_range(date2, date2);
+    QCOMPARE(range.begin()->name(), std::string("Standup"));
+    QCOMPARE(range.begin()->description(), std::string("Daily"));
+
+    // a missing file leaves the calendar untouched
+    QVERIFY(!loaded.load_snapshot(directory.filePath("missing.snap").toStdString()));
+    QCOMPARE(loaded.events_count(date2), 2);
+
+    // empty days are left out without moving the records of the others
+    EventPool pool;
+    std::map<int, DayEvents> days;
+    days[day_ordinal(date1)];
+    days[day_ordinal(date2)].insert({600, 660, pool.create(date2, "Review", 600, 660, "")});
+    std::string days_file = directory.filePath("days.snap").toStdString();
+    QVERIFY(write_snapshot(days_file, days, pool, 1));
+    SnapshotReader reader;
+    QVERIFY(reader.open(days_file));
+    QCOMPARE(reader.day_count(), 1);
+    QCOMPARE(reader.day_ordinal(0), day_ordinal(date2));
+    QCOMPARE(reader.read_day(0).at(0).name, std::string_view("Review"));
+}
+
+// Test 9
+void calendar_test::journal_replay()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string snapshot_file = directory.filePath("calendar.snap").toStdString();
+    std::string journal_file = directory.filePath("calendar.journal").toStdString();
+
+    Date date1(1, 1, 2000);
+    Date date2(2, 1, 2000);
+    {
+        Calendar calendar;
+        QVERIFY(calendar.open_journal(journal_file, 4));
+        calendar.change_date(date1);
+        calendar.add_event("First", 60, 120, "");
+        calendar.add_event("Second", 30, 90, "");
+        calendar.add_event("Third", 200, 300, "");
+        QVERIFY(calendar.save_snapshot(snapshot_file));
+
+        // changes after the snapshot are only in the journal
+        calendar.delete_event(1);
+        calendar.move_event(1, date2);
+        calendar.add_event("Fourth", 10, 20, "", date2);
+        QVERIFY(calendar.sync_journal());
+        // calendar is dropped without saving, like in a crash
+    }
+
+    Calendar recovered;
+    QVERIFY(recovered.load_snapshot(snapshot_file));
+    QVERIFY(recovered.open_journal(journal_file));
+    QCOMPARE(recovered.events_count(date1), 1);
+    QCOMPARE(recovered.events_count(date2), 2);
+    QVERIFY(recovered.chosen_date() == date1);
+
+    // after saving a new snapshot, the journal is not replayed twice
+    QVERIFY(recovered.save_snapshot(snapshot_file));
+    Calendar restarted;
+    QVERIFY(restarted.load_snapshot(snapshot_file));
+    QVERIFY(restarted.open_journal(journal_file));
+    QCOMPARE(restarted.events_count(date2), 2);
+
+    // a group that does not fill up is synced after the delay
+    std::string delayed_file = directory.filePath("delayed.journal").toStdString();
+    Calendar delayed;
+    QVERIFY(delayed.open_journal(delayed_file, 64, 5));
+    delayed.add_event("Late", 60, 120, "", date1);
+    int records = 0;
+    for (int i = 0; i < 200 && records < 3; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        records = Journal::replay(delayed_file, [](const JournalRecord&) {});
+    }
+    // epoch, chosen date and the added event
+    QCOMPARE(records, 3);
+}
+
+// Test 10
+void calendar_test::recurring_events()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    // every Monday of 2024, starting from Monday 1.1.2024
+    RecurrenceRule weekly;
+    weekly.frequency = Frequency::WEEKLY;
+    weekly.has_until = true;
+    weekly.until = Date(31, 12, 2024);
+    int series = calendar_->add_recurring_event("Standup", 540, 555, "", Date(1, 1, 2024), weekly);
+    QVERIFY(series >= 0);
+
+    // nothing is created before a date is used
+    QCOMPARE(calendar_->memory_usage().events, 0);
+    QVERIFY(calendar_->has_unloaded_days());
+    QCOMPARE(calendar_->loaded_events_count(Date(8, 1, 2024)), 0);
+    QCOMPARE(calendar_->month_summary(1, 2024),
+             std::uint32_t(1u << 0 | 1u << 7 | 1u << 14 | 1u << 21 | 1u << 28));
+    QCOMPARE(calendar_->events_count(Date(8, 1, 2024)), 1);
+    QCOMPARE(calendar_->events_count(Date(9, 1, 2024)), 0);
+    QCOMPARE(calendar_->memory_usage().events, 1);
+    QCOMPARE(calendar_->loaded_events_count(Date(8, 1, 2024)), 1);
+
+    // a deleted occurrence does not come back
+    calendar_->change_date(Date(8, 1, 2024));
+    QVERIFY(calendar_->delete_event(1));
+    QCOMPARE(calendar_->events_count(Date(8, 1, 2024)), 0);
+
+    // exceptions work both before and after the occurrence is created
+    QVERIFY(calendar_->add_recurrence_exception(series, Date(15, 1, 2024)));
+    QCOMPARE(calendar_->events_count(Date(22, 1, 2024)), 1);
+    QVERIFY(calendar_->add_recurrence_exception(series, Date(22, 1, 2024)));
+    QCOMPARE(calendar_->events_count(Date(15, 1, 2024)), 0);
+    QCOMPARE(calendar_->events_count(Date(22, 1, 2024)), 0);
+
+    // 2024 has 53 Mondays, three of them were left out
+    QCOMPARE(calendar_->events_in_range(Date(1, 1, 2024), Date(31, 12, 2025)).size(), 50);
+
+    // monthly series skip months without the day
+    RecurrenceRule monthly;
+    monthly.frequency = Frequency::MONTHLY;
+    monthly.count = 3;
+    calendar_->add_recurring_event("Rent", 600, 610, "", Date(31, 1, 2025), monthly);
+    QCOMPARE(calendar_->events_count(Date(28, 2, 2025)), 0);
+    QCOMPARE(calendar_->events_count(Date(31, 3, 2025)), 1);
+    QCOMPARE(calendar_->events_in_range(Date(1, 1, 2025), Date(31, 12, 2025)).size(), 3);
+
+    // a count and interval whose last occurrence is out of the int range
+    RecurrenceRule sparse;
+    sparse.count = 1000000;
+    sparse.interval = 1000;
+    calendar_->add_recurring_event("Sparse", 700, 710, "", Date(1, 1, 2026), sparse);
+    QCOMPARE(calendar_->events_count(Date(1, 1, 2026)), 1);
+    QCOMPARE(calendar_->events_count(date_from_ordinal(day_ordinal(1, 1, 2026) + 7000)), 1);
+    RecurrenceRule monthly_sparse;
+    monthly_sparse.frequency = Frequency::MONTHLY;
+    monthly_sparse.count = 2000000000;
+    monthly_sparse.interval = 1000;
+    calendar_->add_recurring_event("Monthly", 700, 710, "", Date(1, 1, 2026), monthly_sparse);
+    QCOMPARE(calendar_->events_count(Date(1, 1, 2026)), 2);
+
+    // the series and its exceptions are recorded, but not its occurrences
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string journal_file = directory.filePath("series.journal").toStdString();
+    std::string snapshot_file = directory.filePath("series.snapshot").toStdString();
+    auto count_records = [&journal_file]()
+    {
+        return Journal::replay(journal_file, [](const JournalRecord&) {});
+    };
+    {
+        Calendar calendar;
+        QVERIFY(calendar.open_journal(journal_file, 1));
+        int standup = calendar.add_recurring_event("Standup", 540, 555, "", Date(1, 1, 2024),
+                                                   weekly);
+        QVERIFY(calendar.add_event("Review", 600, 660, "", Date(8, 1, 2024)));
+        int records = count_records();
+        QCOMPARE(calendar.events_in_range(Date(1, 1, 2024), Date(31, 12, 2024)).size(), 54);
+        QCOMPARE(count_records(), records);
+
+        // the review comes after the occurrence on its day
+        calendar.change_date(Date(8, 1, 2024));
+        QVERIFY(calendar.delete_event(2));
+        QVERIFY(calendar.add_recurrence_exception(standup, Date(15, 1, 2024)));
+        calendar.change_date(Date(22, 1, 2024));
+        QVERIFY(calendar.move_event(1, Date(23, 1, 2024)));
+    }
+
+    Calendar recovered;
+    QVERIFY(recovered.open_journal(journal_file));
+    QCOMPARE(recovered.events_count(Date(8, 1, 2024)), 1);
+    QCOMPARE(recovered.events_count(Date(15, 1, 2024)), 0);
+    QCOMPARE(recovered.events_count(Date(22, 1, 2024)), 0);
+    QCOMPARE(recovered.events_count(Date(23, 1, 2024)), 1);
+    QCOMPARE(recovered.events_in_range(Date(1, 1, 2024), Date(31, 12, 2024)).size(), 52);
+    QVERIFY(recovered.save_snapshot(snapshot_file));
+
+    Calendar restarted;
+    QVERIFY(restarted.load_snapshot(snapshot_file));
+    QCOMPARE(restarted.memory_usage().events, 0);
+    QCOMPARE(restarted.events_count(Date(15, 1, 2024)), 0);
+    QCOMPARE(restarted.events_count(Date(23, 1, 2024)), 1);
+    QCOMPARE(restarted.events_in_range(Date(1, 1, 2024), Date(31, 12, 2024)).size(), 52);
+
+    // occurrences between the stored events of a day are not counted in
+    // the positions recorded, so the right events are changed on replay
+    std::string mixed_file = directory.filePath("mixed.journal").toStdString();
+    Date monday(5, 2, 2024);
+    {
+        Calendar calendar;
+        QVERIFY(calendar.open_journal(mixed_file, 1));
+        RecurrenceRule daily;
+        daily.frequency = Frequency::DAILY;
+        calendar.add_recurring_event("Early", 100, 110, "", monday, daily);
+        calendar.add_recurring_event("Noon", 720, 730, "", monday, daily);
+        calendar.change_date(monday);
+        calendar.add_event("A", 50, 60, "");
+        calendar.add_event("B", 600, 610, "");
+        calendar.add_event("C", 800, 810, "");
+        calendar.add_event("D", 900, 910, "");
+        // A, Early, B, Noon, C, D
+        QVERIFY(calendar.delete_event(5));
+        QVERIFY(calendar.move_event(3, Date(6, 2, 2024)));
+    }
+    Calendar mixed;
+    QVERIFY(mixed.open_journal(mixed_file));
+    std::vector<std::string> names;
+    for (const Event& event : mixed.events_in_range(monday, monday))
+        names.push_back(event.name());
+    QVERIFY(names == std::vector<std::string>({"A", "Early", "Noon", "D"}));
+    QCOMPARE(mixed.events_count(Date(6, 2, 2024)), 3);
+
+    // reading a daily series month by month for 30 years does not keep
+    // every occurrence, days are created again when used
+    Calendar reader;
+    RecurrenceRule daily;
+    daily.frequency = Frequency::DAILY;
+    reader.add_recurring_event("Daily", 60, 70, "", Date(1, 1, 2000), daily);
+    reader.add_event("Kept", 80, 90, "", Date(2, 1, 2000));
+    reader.change_date(Date(3, 1, 2000));
+    QVERIFY(reader.delete_event(1));
+    int most_events = 0;
+    for (int year = 2000; year < 2030; ++year)
+    {
+        for (int month = 1; month <= 12; ++month)
+        {
+            Date first(1, month, year);
+            Date last(Date::days_in_month(month, year), month, year);
+            // in January one occurrence is deleted and one event is added
+            QCOMPARE(reader.events_in_range(first, last).size(),
+                     Date::days_in_month(month, year));
+            most_events = std::max(most_events, reader.memory_usage().events);
+        }
+    }
+    QVERIFY(most_events < 8192);
+    QCOMPARE(reader.events_count(Date(2, 1, 2000)), 2);
+    QCOMPARE(reader.events_count(Date(3, 1, 2000)), 0);
+    QCOMPARE(reader.events_count(Date(4, 1, 2000)), 1);
+    QCOMPARE(reader.month_summary(1, 2000), std::uint32_t(0x7ffffffb));
+}
+
+// Test 11
+void calendar_test::stable_ids_and_batch_changes()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string journal_file = directory.filePath("calendar.journal").toStdString();
+
+    Date date1(1, 1, 2000);
+    Date date2(2, 1, 2000);
+    Date date3(3, 1, 2000);
+    std::vector<std::string> expected;
+    {
+        Calendar calendar;
+        QVERIFY(calendar.open_journal(journal_file, 1));
+        calendar.change_date(date1);
+        for (int i = 0; i < 6; ++i)
+            calendar.add_event("Event" + std::to_string(i), 60, 120, "");
+        calendar.add_event("Other", 10, 20, "", date2);
+
+        // a handle points to the same event after others are deleted
+        EventId third = 0;
+        EventId fifth = 0;
+        QVERIFY(calendar.event_id(3, third));
+        QVERIFY(calendar.event_id(5, fifth));
+        QVERIFY(calendar.delete_by_id(third));
+        QVERIFY(!calendar.delete_by_id(third));
+        QCOMPARE(calendar.event(fifth).name(), std::string("Event4"));
+
+        // events of two days are moved together
+        EventId first = 0;
+        EventId other = 0;
+        QVERIFY(calendar.event_id(1, first));
+        calendar.change_date(date2);
+        QVERIFY(calendar.event_id(1, other));
+        calendar.change_date(date1);
+        QCOMPARE(calendar.move_events({first, fifth, other}, date3), 3);
+        QCOMPARE(calendar.events_count(date1), 3);
+        QCOMPARE(calendar.events_count(date2), 0);
+        QCOMPARE(calendar.events_count(date3), 3);
+        QVERIFY(calendar.event(fifth).date() == date3);
+
+        // unknown and repeated handles are skipped
+        EventId second = 0;
+        QVERIFY(calendar.event_id(1, second));
+        QCOMPARE(calendar.delete_events({second, second, third}), 1);
+        EventId last = 0;
+        QVERIFY(calendar.event_id(2, last));
+        QVERIFY(calendar.move_by_id(last, date2));
+
+        for (const Event& event : calendar.events_in_range(date1, date3))
+            expected.push_back(event.name());
+        QVERIFY(calendar.sync_journal());
+    }
+
+    // replaying gives the same events in the same order
+    Calendar recovered;
+    QVERIFY(recovered.open_journal(journal_file));
+    std::vector<std::string> replayed;
+    for (const Event& event : recovered.events_in_range(date1, date3))
+        replayed.push_back(event.name());
+    QVERIFY(replayed == expected);
+    QVERIFY(recovered.chosen_date() == date1);
+
+    // a reclaimed slot is reused, but the old handle does not reach the new event
+    EventPool pool;
+    EventId old_id = pool.create(date1, "Old", 60, 120, "");
+    pool.release(old_id);
+    pool.reclaim(old_id);
+    std::size_t bytes = pool.event_bytes();
+    EventId new_id = pool.create(date1, "New", 60, 120, "");
+    QVERIFY(new_id != old_id);
+    QVERIFY(pool.contains(new_id));
+    QVERIFY(!pool.contains(old_id));
+    QVERIFY(!pool.restore(old_id));
+    QCOMPARE(pool.size(), 1);
+    QCOMPARE(pool.event_bytes(), bytes);
+
+    // the same through the calendar, whose lookups fail for the old handle
+    Calendar calendar;
+    calendar.set_history_budget(0);
+    calendar.add_event("Old", 60, 120, "", date1);
+    EventId deleted = 0;
+    calendar.change_date(date1);
+    QVERIFY(calendar.event_id(1, deleted));
+    QVERIFY(calendar.delete_by_id(deleted));
+    calendar.add_event("New", 60, 120, "", date1);
+    QVERIFY(calendar.find_event(deleted) == nullptr);
+    QCOMPARE(calendar.event(deleted).name(), std::string());
+    QVERIFY(!calendar.delete_by_id(deleted));
+    QVERIFY(!calendar.move_by_id(deleted, date2));
+    QCOMPARE(calendar.events_count(date1), 1);
+}
+
+// Test 12
+void calendar_test::buffered_writer()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string file_name = directory.filePath("output.txt").toStdString();
+    int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    QVERIFY(fd >= 0);
+
+    auto file_contents = [&file_name]()
+    {
+        std::ifstream file(file_name);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    };
+
+    {
+        // small buffer, so the writer also has to flush when it gets full
+        BufferedWriter writer(fd, 16);
+        std::ostream output(&writer);
+
+        // std::endl does not write anything out
+        output << "first" << std::endl;
+        QCOMPARE(file_contents(), std::string(""));
+
+        // buffered output (e.g. a prompt) can be taken back
+        std::size_t prompt_start = writer.position();
+        output << "> ";
+        QVERIFY(writer.discard_from(prompt_start));
+        output << "second line" << std::endl;
+        QVERIFY(writer.flush());
+        QCOMPARE(file_contents(), std::string("first\nsecond line\n"));
+
+        // written output can not
+        QVERIFY(!writer.discard_from(prompt_start));
+
+        output << std::string(40, 'x') << '\n';
+    }
+    // the rest is written when the writer is destroyed
+    QCOMPARE(file_contents().size(), std::size_t(18 + 41));
+    ::close(fd);
+}
+
+// Test 13
+void calendar_test::concurrent_stress()
+{
+    ConcurrentCalendar calendar(8);
+    std::atomic<int> added(0);
+    std::atomic<int> deleted(0);
+
+    // every thread adds, deletes, moves and reads events of all months
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&calendar, &added, &deleted, t]()
+        {
+            for (int i = 0; i < 2000; ++i)
+            {
+                Date date(1 + i % 28, 1 + (i + t) % 12, 2024);
+                switch (i % 5)
+                {
+                case 0:
+                case 1:
+                case 2:
+                    if (calendar.add_event("Event", i % 1400, i % 1400 + 5, "", date))
+                        added++;
+                    break;
+                case 3:
+                    if (calendar.delete_event(date, 1))
+                        deleted++;
+                    break;
+                default:
+                    calendar.move_event(date, 1, Date(1 + i % 28, 1 + (i + t + 5) % 12, 2024));
+                    calendar.events_count(date);
+                    calendar.events_in_range(Date(1, 1, 2024), Date(31, 3, 2024));
+                    break;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // moves keep the amount of events, nothing is lost or counted twice
+    QCOMPARE(calendar.size(), added - deleted);
+    QCOMPARE((int)calendar.events_in_range(Date(1, 1, 2024), Date(31, 12, 2024)).size(),
+             added - deleted);
+
+    // events of a range come in date order across shards
+    std::vector<EventData> events = calendar.events_in_range(Date(1, 1, 2024), Date(31, 12, 2024));
+    for (size_t i = 1; i < events.size(); ++i)
+        QVERIFY(!(events.at(i).date < events.at(i - 1).date));
+}
+
+// Test 14
+void calendar_test::search_words()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = std::make_shared<Calendar>();
+
+    Date january(10, 1, 2024);
+    Date february(10, 2, 2024);
+    Date year_start(1, 1, 2024);
+    Date year_end(31, 12, 2024);
+    calendar_->add_event("Audit prep", 500, 560, "", january);
+    calendar_->add_event("Lunch", 700, 760, "In the auditorium", january);
+    calendar_->add_event("Quarterly AUDIT", 600, 660, "Review with finance", february);
+
+    // words are compared without case, '*' matches a prefix
+    QCOMPARE(calendar_->search("audit", year_start, year_end).size(), std::size_t(2));
+    QCOMPARE(calendar_->search("audit*", year_start, year_end).size(), std::size_t(3));
+    QCOMPARE(calendar_->search("audit rev*", year_start, year_end).size(), std::size_t(1));
+    QCOMPARE(calendar_->search("audit lunch", year_start, year_end).size(), std::size_t(0));
+    QCOMPARE(calendar_->search("", year_start, year_end).size(), std::size_t(0));
+
+    // only the dates of the range are searched
+    std::vector<EventId> found = calendar_->search("audit", year_start, Date(31, 1, 2024));
+    QCOMPARE(found.size(), std::size_t(1));
+    QCOMPARE(calendar_->event(found.front()).name(), std::string("Audit prep"));
+
+    // the index follows moved, deleted and added events
+    calendar_->change_date(january);
+    QVERIFY(calendar_->move_event(1, Date(1, 3, 2024)));
+    QCOMPARE(calendar_->search("prep", year_start, Date(31, 1, 2024)).size(), std::size_t(0));
+    QCOMPARE(calendar_->search("prep", Date(1, 3, 2024), year_end).size(), std::size_t(1));
+    QVERIFY(calendar_->delete_event(1));
+    QCOMPARE(calendar_->search("audit*", year_start, year_end).size(), std::size_t(2));
+    calendar_->add_event("Audit follow-up", 600, 660, "", january);
+    QCOMPARE(calendar_->search("follow audit", year_start, year_end).size(), std::size_t(1));
+
+    // days of a snapshot and occurrences of a series are loaded only if they may match
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string snapshot_file = directory.filePath("search.snapshot").toStdString();
+    QVERIFY(calendar_->save_snapshot(snapshot_file));
+    Calendar restored;
+    QVERIFY(restored.load_snapshot(snapshot_file));
+    RecurrenceRule weekly;
+    weekly.frequency = Frequency::WEEKLY;
+    weekly.count = 3;
+    restored.add_recurring_event("Audit sync", 540, 600, "", Date(8, 1, 2024), weekly);
+
+    QCOMPARE(restored.search("follow audit", year_start, year_end).size(), std::size_t(1));
+    QCOMPARE(restored.memory_usage().events, 1);
+    QCOMPARE(restored.search("sync", year_start, year_end).size(), std::size_t(3));
+    QCOMPARE(restored.memory_usage().events, 4);
+    QCOMPARE(restored.search("audit", year_start, year_end).size(), std::size_t(6));
+
+    // texts of deleted events are freed, a new text in the place of a
+    // freed one has its own words
+    Calendar churn;
+    churn.set_history_budget(0);
+    churn.change_date(january);
+    churn.add_event("Alpha", 60, 70, "");
+    QCOMPARE(churn.search("alpha", year_start, year_end).size(), std::size_t(1));
+    QVERIFY(churn.delete_event(1));
+    churn.add_event("Beta", 60, 70, "");
+    QCOMPARE(churn.search("alpha", year_start, year_end).size(), std::size_t(0));
+    QCOMPARE(churn.search("beta", year_start, year_end).size(), std::size_t(1));
+
+    std::size_t string_bytes = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        churn.add_event("Note", 80, 90, "Description number " + std::to_string(i));
+        QVERIFY(churn.delete_event(2));
+        if (i == 9)
+            string_bytes = churn.memory_usage().string_bytes;
+    }
+    QCOMPARE(churn.memory_usage().string_bytes, string_bytes);
+}
+
+// Test 15
+void calendar_test::export_events()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = std::make_shared<Calendar>();
+
+    calendar_->add_event("Plan, \"Q3\"", 480, 545, "Line 1\nLine 2", Date(5, 3, 2024));
+    calendar_->add_event("Lunch", 720, 780, "", Date(4, 3, 2024));
+
+    // the whole calendar, in date order
+    std::ostringstream json;
+    QCOMPARE(calendar_->export_events(*json.rdbuf(), ExportFormat::JSON_LINES), 2);
+    QCOMPARE(json.str(), std::string(
+        "{\"date\":\"2024-03-04\",\"start\":\"12:00\",\"end\":\"13:00\","
+        "\"name\":\"Lunch\",\"description\":\"\"}\n"
+        "{\"date\":\"2024-03-05\",\"start\":\"08:00\",\"end\":\"09:05\","
+        "\"name\":\"Plan, \\\"Q3\\\"\",\"description\":\"Line 1\\nLine 2\"}\n"));
+
+    // a date range, fields with separators or quotes are quoted
+    std::ostringstream csv;
+    QCOMPARE(calendar_->export_events(*csv.rdbuf(), ExportFormat::CSV,
+                                      Date(5, 3, 2024), Date(31, 3, 2024)), 1);
+    QCOMPARE(csv.str(), std::string(
+        "date,start,end,name,description\n"
+        "2024-03-05,08:00,09:05,\"Plan, \"\"Q3\"\"\",\"Line 1\nLine 2\"\n"));
+}
+
+// Test 16
+void calendar_test::reminders_followChanges()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = std::make_shared<Calendar>();
+
+    Date today(1, 1, 2024);
+    Date tomorrow(2, 1, 2024);
+    int ordinal = day_ordinal(today);
+    SimulatedClock clock(to_instant(ordinal, 8 * 60));
+
+    calendar_->add_event("Past", 7 * 60, 8 * 60, "", today);
+    calendar_->add_event("Meeting", 9 * 60, 10 * 60, "", today);
+    calendar_->add_event("Review", 9 * 60, 10 * 60, "", tomorrow);
+
+    // reminders are due 15 minutes before the start, past events have none
+    calendar_->start_reminders(clock.now(), 15);
+    Reminder reminder;
+    QVERIFY(calendar_->next_due(clock.now(), reminder));
+    QCOMPARE(reminder.due, to_instant(ordinal, 9 * 60 - 15));
+    QCOMPARE(calendar_->event(reminder.id).name(), std::string("Meeting"));
+    QVERIFY(calendar_->pop_due(clock.now()).empty());
+
+    clock.advance(45);
+    std::vector<Reminder> due = calendar_->pop_due(clock.now());
+    QCOMPARE(due.size(), std::size_t(1));
+    QCOMPARE(calendar_->event(due.front().id).name(), std::string("Meeting"));
+
+    // added, moved and deleted events update their reminders
+    calendar_->add_event("Call", 11 * 60, 12 * 60, "", today);
+    QVERIFY(calendar_->next_due(clock.now(), reminder));
+    EventId call = reminder.id;
+    QCOMPARE(calendar_->event(call).name(), std::string("Call"));
+    QVERIFY(calendar_->move_by_id(call, Date(3, 1, 2024)));
+    QVERIFY(calendar_->next_due(clock.now(), reminder));
+    QCOMPARE(calendar_->event(reminder.id).name(), std::string("Review"));
+    QVERIFY(calendar_->delete_by_id(reminder.id));
+    QVERIFY(calendar_->next_due(clock.now(), reminder));
+    QCOMPARE(reminder.id, call);
+
+    // occurrences of a series are reminded as the clock goes on
+    RecurrenceRule daily;
+    daily.frequency = Frequency::DAILY;
+    calendar_->add_recurring_event("Standup", 10 * 60, 10 * 60 + 15, "", today, daily);
+    clock.set(to_instant(ordinal + 30, 0));
+    QCOMPARE(calendar_->pop_due(clock.now()).size(), std::size_t(31));
+    QVERIFY(calendar_->next_due(clock.now(), reminder));
+    QCOMPARE(reminder.due, to_instant(ordinal + 30, 10 * 60 - 15));
+
+    // an undone add frees its slot for the next events, which keep
+    // their own reminders
+    Date later(1, 3, 2024);
+    int later_ordinal = day_ordinal(later);
+    calendar_->add_event("Undone", 9 * 60, 10 * 60, "", later);
+    QVERIFY(calendar_->undo());
+    calendar_->add_event("First", 8 * 60, 9 * 60, "", later);
+    calendar_->add_event("Second", 7 * 60, 8 * 60, "", later);
+    clock.set(to_instant(later_ordinal, 0));
+    due = calendar_->pop_due(clock.now() + 8 * 60);
+    QVERIFY(due.size() >= 2);
+    QCOMPARE(calendar_->event(due.at(due.size() - 2).id).name(), std::string("Second"));
+    QCOMPARE(calendar_->event(due.back().id).name(), std::string("First"));
+}
+
+// Test 17
+void calendar_test::free_busy_acrossCalendars()
+{
+    Date first(1, 1, 2024);
+    Date second(2, 1, 2024);
+    int ordinal = day_ordinal(first);
+
+    Calendar person;
+    person.add_event("A", 60, 120, "", first);
+    person.add_event("B", 100, 200, "", first);
+    person.add_event("C", 200, 300, "", first);
+
+    Calendar room;
+    room.add_event("D", 500, 600, "", first);
+    room.add_event("E", 23 * 60, 24 * 60, "", first);
+    room.add_event("F", 0, 30, "", second);
+
+    // overlapping and touching events are one busy interval
+    std::vector<TimeInterval> busy = busy_intervals(person, first, second);
+    QCOMPARE(busy.size(), std::size_t(1));
+    QCOMPARE(busy.front().start, to_instant(ordinal, 60));
+    QCOMPARE(busy.front().end, to_instant(ordinal, 300));
+
+    // busy time over midnight is merged, short gaps are left out
+    std::vector<TimeInterval> free_slots =
+        common_free_slots({&person, &room}, first, second, 61, 2);
+    QCOMPARE(free_slots.size(), std::size_t(3));
+    QCOMPARE(free_slots.at(0).start, to_instant(ordinal, 300));
+    QCOMPARE(free_slots.at(0).end, to_instant(ordinal, 500));
+    QCOMPARE(free_slots.at(2).start, to_instant(ordinal + 1, 30));
+    QCOMPARE(free_slots.at(2).end, to_instant(ordinal + 2, 0));
+
+    // same result with one thread and with more threads than calendars
+    std::vector<TimeInterval> one_thread =
+        common_free_slots({&person, &room}, first, second, 61, 1);
+    std::vector<TimeInterval> many_threads =
+        common_free_slots({&person, &room}, first, second, 61, 8);
+    QCOMPARE(one_thread.size(), free_slots.size());
+    QCOMPARE(many_threads.size(), free_slots.size());
+
+    // busy time up to the end of the range leaves no empty slot there
+    Calendar late;
+    late.add_event("G", 23 * 60, 24 * 60, "", second);
+    free_slots = common_free_slots({&person, &room, &late}, first, second, 0, 2);
+    QCOMPARE(free_slots.size(), std::size_t(4));
+    for (const TimeInterval& slot : free_slots)
+        QVERIFY(slot.start < slot.end);
+    QCOMPARE(free_slots.at(0).start, to_instant(ordinal, 0));
+    QCOMPARE(free_slots.at(3).end, to_instant(ordinal + 1, 23 * 60));
+}
+
+// Test 18
+void calendar_test::undo_redo()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    Date date1(1, 1, 2024);
+    Date date2(2, 1, 2024);
+    calendar_->change_date(date1);
+    QVERIFY(!calendar_->undo());
+
+    calendar_->add_event("A", 60, 120, "");
+    calendar_->add_event("B", 200, 300, "");
+    EventId id_b = 0;
+    QVERIFY(calendar_->event_id(2, id_b));
+
+    // undoing a delete brings back the event with its handle
+    QVERIFY(calendar_->delete_event(1));
+    QCOMPARE(calendar_->events_count(date1), 1);
+    QVERIFY(calendar_->undo());
+    QCOMPARE(calendar_->events_count(date1), 2);
+    QCOMPARE(calendar_->event(id_b).name(), std::string("B"));
+
+    // move and its redo
+    QVERIFY(calendar_->move_by_id(id_b, date2));
+    QVERIFY(calendar_->undo());
+    QCOMPARE(calendar_->events_count(date2), 0);
+    QVERIFY(calendar_->redo());
+    QCOMPARE(calendar_->events_count(date2), 1);
+    QVERIFY(!calendar_->redo());
+
+    // a batch is undone as one step
+    std::vector<EventData> events;
+    for (int i = 0; i < 10; ++i)
+        events.push_back({date2, "batch", i * 60, i * 60 + 30, ""});
+    QCOMPARE(calendar_->add_events(events), 10);
+    QCOMPARE(calendar_->events_count(date2), 11);
+    QVERIFY(calendar_->undo());
+    QCOMPARE(calendar_->events_count(date2), 1);
+
+    // a new change after an undo cannot be combined with redo
+    calendar_->add_event("C", 400, 500, "", date2);
+    QVERIFY(!calendar_->redo());
+
+    // only the latest changes fit in a small budget
+    calendar_->set_history_budget(2 * sizeof(HistoryEntry));
+    QVERIFY(calendar_->undo());
+    QVERIFY(calendar_->undo());
+    QVERIFY(!calendar_->undo());
+    QCOMPARE(calendar_->events_count(date1), 2);
+    QCOMPARE(calendar_->events_count(date2), 0);
+
+    // a forgotten delete gives the slot of its event to new events
+    calendar_->set_history_budget(0);
+    calendar_->add_event("D", 60, 120, "", date2);
+    std::size_t event_bytes = calendar_->memory_usage().event_bytes;
+    calendar_->change_date(date2);
+    QVERIFY(calendar_->delete_event(1));
+    calendar_->add_event("E", 60, 120, "", date2);
+    QCOMPARE(calendar_->memory_usage().event_bytes, event_bytes);
+
+    // a group begun inside another group is part of it
+    History history;
+    history.begin_group();
+    history.record(HistoryAction::REMOVE, 1);
+    history.begin_group();
+    history.record(HistoryAction::REMOVE, 2);
+    history.end_group();
+    history.record(HistoryAction::REMOVE, 3);
+    history.end_group();
+    QCOMPARE(history.take_undo().size(), std::size_t(3));
+}
+
+// Test 19
+void calendar_test::archive_oldDays()
+{
+    // create a new calendar
+    calendar_.reset();
+    calendar_ = make_shared<Calendar>();
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string file_name = directory.filePath("archive.seg").toStdString();
+
+    Date old_date(5, 3, 2020);
+    Date new_date(5, 3, 2024);
+    calendar_->add_event("old", 60, 120, "first", old_date);
+    calendar_->add_event("older", 30, 60, "", old_date);
+    calendar_->add_event("new", 60, 120, "", new_date);
+    uint32_t summary = calendar_->month_summary(3, 2020);
+    EventId before_archive = 0;
+    calendar_->change_date(old_date);
+    QVERIFY(calendar_->event_id(2, before_archive));
+
+    QCOMPARE(calendar_->archive_before(Date(1, 1, 2024), file_name), 1);
+    QCOMPARE(calendar_->memory_usage().events, 1);
+    QCOMPARE(calendar_->month_summary(3, 2020), summary);
+    // the kept event may get the slot of an archived one, but not its handle
+    QVERIFY(calendar_->find_event(before_archive) == nullptr);
+    QVERIFY(!calendar_->delete_by_id(before_archive));
+    QCOMPARE(calendar_->events_count(new_date), 1);
+
+    // the day is loaded back in the same order when it is used
+    calendar_->change_date(old_date);
+    EventId id = 0;
+    QVERIFY(calendar_->event_id(2, id));
+    QCOMPARE(calendar_->event(id).name(), std::string("old"));
+    QCOMPARE(calendar_->event(id).description(), std::string("first"));
+    QCOMPARE(calendar_->memory_usage().events, 3);
+
+    // nothing left before the cutoff
+    QCOMPARE(calendar_->archive_before(Date(1, 1, 2020), file_name), 0);
+}
+
+// Test 20
+void calendar_test::daemon_pipelinedRequests()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    std::string socket_path = directory.filePath("calendar.sock").toStdString();
+
+    CalendarServer server(2);
+    QVERIFY(server.listen(socket_path));
+    std::thread loop([&server] { server.run(); });
+
+    CalendarClient client;
+    QVERIFY(client.connect(socket_path));
+
+    // all requests are written before any response is read
+    Date date(5, 3, 2024);
+    client.request_add("work", date, 60, 120, "A", "first");
+    client.request_add("work", date, 30, 60, "B", "");
+    client.request_add("work", date, 120, 60, "invalid", "");
+    client.request_count("work", date);
+    client.request_day("work", date);
+    client.request_conflict("work", date, 100, 110);
+    client.request_delete("home", date, 1);
+    QVERIFY(client.flush());
+
+    // responses come in the order of the requests
+    std::vector<Status> statuses = {Status::OK, Status::OK, Status::FAILED, Status::OK,
+                                    Status::OK, Status::OK, Status::FAILED};
+    for (uint32_t i = 0; i < statuses.size(); ++i)
+    {
+        Frame response;
+        QVERIFY(client.receive(response));
+        QCOMPARE(response.request, i);
+        QCOMPARE(response.code, (uint8_t)statuses.at(i));
+
+        PayloadReader payload(response.payload);
+        uint32_t count = 0;
+        if (i == 3)
+        {
+            QVERIFY(payload.read_u32(count));
+            QCOMPARE(count, 2u);
+        }
+        else if (i == 4)
+        {
+            // the day is ordered by time
+            int32_t start = 0;
+            int32_t end = 0;
+            std::string_view name;
+            std::string_view description;
+            QVERIFY(payload.read_u32(count));
+            QCOMPARE(count, 2u);
+            QVERIFY(payload.read_i32(start) && payload.read_i32(end));
+            QVERIFY(payload.read_text(name) && payload.read_text(description));
+            QCOMPARE(name, std::string_view("B"));
+            QCOMPARE(start, 30);
+        }
+        else if (i == 5)
+        {
+            uint8_t taken = 0;
+            QVERIFY(payload.read_u8(taken));
+            QCOMPARE(taken, uint8_t(1));
+        }
+    }
+    QCOMPARE(client.pending(), std::size_t(0));
+    QCOMPARE(server.calendar_count(), std::size_t(2));
+
+    // the socket of a running server is not taken over
+    CalendarServer other(1);
+    QVERIFY(!other.listen(socket_path));
+
+    // a day that does not fit in one frame, and many responses that are
+    // not read until all requests are sent
+    std::string description(60000, 'x');
+    client.request_add("big", date, 0, 30, "big", description);
+    client.request_day("big", date);
+    for (int i = 1; i < 20; ++i)
+        client.request_add("big", date, i * 60, i * 60 + 30, "big", description);
+    for (int i = 0; i < 40; ++i)
+        client.request_day("big", date);
+    // more responses than the server keeps unwritten for a client
+    Date next(6, 3, 2024);
+    client.request_add("big", next, 0, 30, "big", description);
+    for (int i = 0; i < 200; ++i)
+        client.request_day("big", next);
+    QVERIFY(client.flush());
+
+    for (uint32_t i = 0; i < 262; ++i)
+    {
+        Frame response;
+        QVERIFY(client.receive(response));
+        QCOMPARE(response.request, i + 7);
+        if (i < 21 || i >= 61)
+        {
+            QCOMPARE(response.code, (uint8_t)Status::OK);
+        }
+        else
+        {
+            QCOMPARE(response.code, (uint8_t)Status::TOO_LARGE);
+            QVERIFY(response.payload.empty());
+        }
+    }
+    QCOMPARE(client.pending(), std::size_t(0));
+
+    // a job runs requests only until its responses fill the budget
+    std::string requests;
+    for (uint32_t i = 0; i < 10; ++i)
+        FrameBuilder(requests, i, (uint8_t)Command::DAY).add_text("big").add_date(next).finish();
+    std::string responses;
+    std::size_t handled = server.handle(requests, responses, 100000);
+    QCOMPARE(handled, requests.size() / 5);
+    QVERIFY(responses.size() >= 100000 && responses.size() < 100000 + MAX_FRAME_SIZE);
+
+    server.stop();
+    loop.join();
+}
+
+QTEST_APPLESS_MAIN(calendar_test)
+
+#include "tst_calendar_test.moc"
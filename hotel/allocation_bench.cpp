@@ -0,0 +1,73 @@
+/*
+ * Benchmark of room allocation. Books guests to hotels of 1k..1M rooms
+ * with each allocation policy and prints the average time of a book.
+ * A guest leaves when as many guests as there are rooms have come after
+ * them, so the hotel stays partly free and almost every book gets a room.
+ *
+ * Not part of the hotel program, it has its own main. Build it with the
+ * hotel sources except main.cpp, for example:
+ *   g++ -O2 -std=c++17 -o allocation_bench allocation_bench.cpp \
+ *       hotel.cpp person.cpp visit.cpp utils.cpp date.cpp
+ */
+#include "hotel.hh"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// amount of books in each run
+const int BOOKS = 1000000;
+
+/*
+ * Books BOOKS guests to a hotel of the given amount of rooms and
+ * returns the average time of a book and a leave in microseconds.
+ */
+double time_books(int rooms, AllocationPolicy policy,
+                  const vector<string>& names, const vector<string>& sizes)
+{
+    Hotel hotel;
+    hotel.set_allocation_policy(policy);
+    // the same sizes 1..8 as the requests
+    for(int i = 0; i < rooms; ++i)
+        hotel.add_room(i + 1, 1 + i % 8);
+
+    // the messages of book and leave are not printed
+    cout.setstate(ios::failbit);
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < BOOKS; ++i)
+    {
+        hotel.book({names.at(i), sizes.at(i % sizes.size())});
+        if(i >= rooms)
+            hotel.leave({names.at(i - rooms)});
+    }
+    chrono::duration<double> time = chrono::steady_clock::now() - start;
+    cout.clear();
+    return time.count() / BOOKS * 1e6;
+}
+
+int main()
+{
+    vector<string> names;
+    names.reserve(BOOKS);
+    for(int i = 0; i < BOOKS; ++i)
+        names.push_back("guest-" + to_string(i));
+    vector<string> sizes;
+    for(int size = 1; size <= 8; ++size)
+        sizes.push_back(to_string(size));
+
+    cout << "rooms     exact     best-fit  least-loaded" << endl;
+    for(int rooms : {1000, 10000, 100000, 1000000})
+    {
+        cout << rooms;
+        for(AllocationPolicy policy : {AllocationPolicy::EXACT,
+                                       AllocationPolicy::BEST_FIT,
+                                       AllocationPolicy::LEAST_LOADED})
+        {
+            cout << "  " << time_books(rooms, policy, names, sizes) << " us";
+        }
+        cout << endl;
+    }
+    return 0;
+}
@@ -97,6 +97,31 @@ void Hotel::advance_date(Params params)
     cout << endl;
 }
 
+/*
+ * Function that sets how rooms are chosen for guests.
+ */
+void Hotel::set_policy(Params params)
+{
+    string policy = params.at(0);
+    if(policy == "exact")
+        set_allocation_policy(AllocationPolicy::EXACT);
+    else if(policy == "best-fit")
+        set_allocation_policy(AllocationPolicy::BEST_FIT);
+    else if(policy == "least-loaded")
+        set_allocation_policy(AllocationPolicy::LEAST_LOADED);
+    else
+    {
+        cout << CANT_FIND << policy << endl;
+        return;
+    }
+    cout << "Allocation policy has been set to " << policy << endl;
+}
+
+void Hotel::set_allocation_policy(AllocationPolicy policy)
+{
+    policy_ = policy;
+}
+
 /*
  * Function that prints info about all the hotel rooms
  */
@@ -114,56 +139,156 @@ void Hotel::print_rooms(Params  /*params*/)
             << endl;
     }
 }
+/*
+ * Orders guests by name.
+ */
+bool GuestByName::operator()(const Person* guest1, const Person* guest2) const
+{
+    return guest1->name() < guest2->name();
+}
+/*
+ * Orders available rooms by visitors and then by room number.
+ */
+bool AvailableRoom::operator<(const AvailableRoom& other) const
+{
+    if(current_visitors != other.current_visitors)
+        return current_visitors < other.current_visitors;
+    if(room_num != other.room_num)
+        return room_num < other.room_num;
+    return index < other.index;
+}
 /**
  * @brief Hotel::get_first_room_by_size
  * @param size the room size requested
  * @return room index
- * A helper function to find the best room
+ * A helper function to find the best room. Only rooms with space are in
+ * the index, so the best room is the first one of its size.
  */
 int Hotel::get_first_room_by_size(int size){
-    int best_index = -1;
-    for (int i = 0; i < (int)rooms_.size(); ++i) {
-        const Room& room = rooms_.at(i);
+    map<int, set<AvailableRoom>>::const_iterator rooms = available_rooms_.find(size);
+    // no room of the size has space
+    if(rooms == available_rooms_.end())
+        return -1;
 
-        // room size doesnt mactch the requested size -> continue
-        if(room.size != size)
-            continue;
+    return rooms->second.begin()->index;
+}
+/*
+ * Finds a room with the current allocation policy. Sizes without
+ * space are not in the index, so with best-fit the first size from
+ * the requested one upwards has a room to give.
+ */
+int Hotel::find_room(int size)
+{
+    switch(policy_)
+    {
+    case AllocationPolicy::BEST_FIT:
+    {
+        map<int, set<AvailableRoom>>::const_iterator rooms = available_rooms_.lower_bound(size);
+        if(rooms == available_rooms_.end())
+            return -1;
+        return rooms->second.begin()->index;
+    }
+    case AllocationPolicy::LEAST_LOADED:
+        return get_least_loaded_room(size);
+    case AllocationPolicy::EXACT:
+        break;
+    }
+    return get_first_room_by_size(size);
+}
+/*
+ * Compares the best room of each size that is large enough. Ties go to
+ * the smaller size, so the work depends on the amount of room sizes
+ * and not on the amount of rooms.
+ */
+int Hotel::get_least_loaded_room(int size)
+{
+    const AvailableRoom* best_room = nullptr;
+    map<int, set<AvailableRoom>>::const_iterator rooms = available_rooms_.lower_bound(size);
+    for(; rooms != available_rooms_.end(); ++rooms)
+    {
+        const AvailableRoom& room = *rooms->second.begin();
+        if(best_room == nullptr || room.current_visitors < best_room->current_visitors)
+            best_room = &room;
+    }
+    return best_room == nullptr ? -1 : best_room->index;
+}
+/*
+ * Moves the room to its new place in the availability index.
+ * A full room is taken out of the index.
+ */
+void Hotel::change_visitors(int room_index, int change)
+{
+    Room& room = rooms_.at(room_index);
+    set<AvailableRoom>& rooms = available_rooms_[room.size];
+    rooms.erase({room.current_visitors, room.room_num, room_index});
 
-        int available_space = room.size - room.current_visitors;
-        // no space available in the room -> continue
-        if (available_space <= 0)
-            continue;
+    room.current_visitors += change;
+    if(room.size - room.current_visitors > 0)
+        rooms.insert({room.current_visitors, room.room_num, room_index});
 
-        // no current best room selected. Select current one
-        if (best_index == -1)
-        {
-            best_index = i;
-        }
-        else
-        {
-            const Room& best_room = rooms_.at(best_index);
+    // sizes without space are not kept
+    if(rooms.empty())
+        available_rooms_.erase(room.size);
+}
+/*
+ * Finds the guest from the hash index.
+ */
+Person* Hotel::find_guest(string_view name)
+{
+    unordered_map<string_view, int>::const_iterator guest = guest_index_.find(name);
+    if(guest == guest_index_.end())
+        return nullptr;
+    return &guests_.at(guest->second);
+}
+/*
+ * Adds a new guest. The key of the index is the name stored in the guest.
+ */
+Person& Hotel::add_guest(const string& name)
+{
+    guests_.push_back(Person(name));
+    guest_index_.insert({guests_.back().name(), (int)guests_.size() - 1});
+    return guests_.back();
+}
+/*
+ * Keeps the sorted view of earlier prints and only sorts the guests added
+ * since then, merging them in.
+ */
+const vector<const Person*>& Hotel::guests_by_name()
+{
+    size_t sorted = sorted_guests_.size();
+    if(sorted == guests_.size())
+        return sorted_guests_;
 
-            // if current room has more visitors in it then best room is current
-            if(room.current_visitors < best_room.current_visitors)
-            {
-                best_index = i;
-            }
-            // if rooms have same amount of visitors select the one with lower room id
-            else if(room.current_visitors == best_room.current_visitors &&
-                     room.room_num < best_room.room_num)
-            {
-                best_index = i;
-            }
-        }
+    for(size_t i = sorted; i < guests_.size(); ++i)
+        sorted_guests_.push_back(&guests_.at(i));
+
+    sort(sorted_guests_.begin() + sorted, sorted_guests_.end(), GuestByName());
+    inplace_merge(sorted_guests_.begin(), sorted_guests_.begin() + sorted,
+                  sorted_guests_.end(), GuestByName());
+    return sorted_guests_;
+}
+/*
+ * A booking adds one visit, so the guest moves from the group of its
+ * earlier count to the next one. Empty groups are removed so the first
+ * group always has the honor guests.
+ */
+void Hotel::count_visit(const Person* guest)
+{
+    int visits = guest->visits();
+    if(visits > 1)
+    {
+        auto old_group = guests_by_visits_.find(visits - 1);
+        old_group->second.erase(guest);
+        if(old_group->second.empty())
+            guests_by_visits_.erase(old_group);
     }
-    return best_index;
+    guests_by_visits_[visits].insert(guest);
 }
 /*
  * A function that handles guest room booking.
  */
 void Hotel::book(Params params)
 {
-    bool guest_exists = false;
     string guest_name = params.at(0);
 
     string room_num = params.at(1);
@@ -174,25 +299,18 @@ void Hotel::book(Params params)
         return;
     }
 
-    // create a new person
-    Person new_person = Person(guest_name);
-    //check if guest already exists
-    if(all_guests_.find(guest_name) != all_guests_.end())
+    // an earlier guest is changed in place
+    Person* guest = find_guest(guest_name);
+    // check if the existing person is already staying at the hotel
+    if(guest != nullptr && guest->is_staying())
     {
-        guest_exists = true;
-        // set the new person to the already existing one
-        new_person = all_guests_.find(guest_name)->second;
-        // check if the existing person is already staying at the hotel
-        if(new_person.staying)
-        {
-            cout << ALREADY_EXISTS << guest_name << endl;
-            return;
-        }
+        cout << ALREADY_EXISTS << guest_name << endl;
+        return;
     }
 
     int room_size = stoi(room_num);
     // get best room based on the size requested
-    int room_index = get_first_room_by_size(room_size);
+    int room_index = find_room(room_size);
     // room doesnt exist
     if(room_index == -1)
     {
@@ -200,21 +318,14 @@ void Hotel::book(Params params)
         return;
     }
 
-    // Init a new visit
-    shared_ptr<Visit> new_visit = make_shared<Visit>(utils::today, room_index);
-    new_visit->next_ = nullptr;
-
-    // Create person and assign visit
-    new_person.make_visit(new_visit);
-    // if guest doesnt exist, create a new person and add it to the hotel all guests
-    if(!guest_exists)
-        all_guests_.insert({guest_name, new_person});
-    // if person exists, modify it
-    else
-        all_guests_.at(guest_name) = new_person;
+    // if guest doesnt exist, create a new person and add it to the hotel guests
+    if(guest == nullptr)
+        guest = &add_guest(guest_name);
+    guest->make_visit(utils::today, room_index);
+    count_visit(guest);
 
     // Assing the used size to the room
-    rooms_.at(room_index).current_visitors++;
+    change_visitors(room_index, 1);
 
     cout << GUEST_ENTERED << endl;
 }
@@ -224,20 +335,19 @@ void Hotel::book(Params params)
 void Hotel::leave(Params params)
 {
     string guest_name = params.at(0);
-    //check if guest already exists
-    if(all_guests_.find(guest_name) == all_guests_.end())
+    // get hold of the guest from the hotel guests database
+    Person* guest = find_guest(guest_name);
+    if(guest == nullptr)
     {
         cout << CANT_FIND << guest_name << endl;
         return;
     }
 
-    // get hold of the guest from the hotel guests database
-    Person& guest = all_guests_.find(guest_name)->second;
-    guest.leave(utils::today);
+    guest->leave(utils::today);
 
     // remove the guest from the room
-    int room_index = guest.last_visit_->room_number();
-    rooms_.at(room_index).current_visitors--;
+    int room_index = guest->last_room();
+    change_visitors(room_index, -1);
 
     cout << GUEST_LEFT << endl;
 
@@ -249,13 +359,14 @@ void Hotel::print_guest_info(Params params)
 {
     string guest_name = params.at(0);
     // check if the guest exists in the hotel guests database
-    if(all_guests_.find(guest_name) == all_guests_.end())
+    const Person* guest = find_guest(guest_name);
+    if(guest == nullptr)
     {
         cout << CANT_FIND << guest_name << endl;
         return;
     }
     // print guest visits
-    all_guests_.find(guest_name)->second.print();
+    guest->print();
 }
 /*
  * Prints all the guests and their visits
@@ -263,18 +374,18 @@ void Hotel::print_guest_info(Params params)
 void Hotel::print_all_visits(Params /*params*/)
 {
     // if there are no guests return and print None
-    if(all_guests_.size() == 0)
+    if(guests_.empty())
     {
         cout << "None" << endl;
         return;
     }
-    // go through all guests in the hotel
-    for(const pair<const string, Person>& guest : all_guests_)
+    // go through all guests in the hotel alphabetically
+    for(const Person* guest : guests_by_name())
     {
         // print the guest name
-        cout << guest.first << endl;
+        cout << guest->name() << endl;
         // print all visits of the guest
-        guest.second.print();
+        guest->print();
     }
 }
 /*
@@ -283,20 +394,20 @@ void Hotel::print_all_visits(Params /*params*/)
 void Hotel::print_current_visits(Params /*params*/)
 {
     // if there are no guests return and print None
-    if(all_guests_.size() == 0)
+    if(guests_.empty())
     {
         cout << "None" << endl;
         return;
     }
 
     bool has_guests_staying = false;
-    // go through every guest in the hotel
-    for(const pair<const string, Person>& guest : all_guests_)
+    // go through every guest in the hotel alphabetically
+    for(const Person* guest : guests_by_name())
     {
         // check if guest is currently staying at the hotel
-        if(guest.second.staying)
+        if(guest->is_staying())
         {
-            cout << guest.first << " is boarded in Room " << guest.second.last_visit_->room_number() + 1 << endl;
+            cout << guest->name() << " is boarded in Room " << guest->last_room() + 1 << endl;
             // set to true
             has_guests_staying = true;
         }
@@ -311,41 +422,40 @@ void Hotel::print_current_visits(Params /*params*/)
 void Hotel::print_honor_guests(Params /*params*/)
 {
     // check if hotel has any guests
-    if(all_guests_.size() == 0)
+    if(guests_by_visits_.empty())
     {
         cout << "None" << endl;
         return;
     }
 
-    // the most visits a guest made
-    int max_visits = 0;
-    vector<string> honorable_guests;
-    // go through each guest in the hotel
-    for(const pair<const string, Person>& guest : all_guests_)
-    {
-        // get total amount of guest visits
-        int guest_total_visits = guest.second.visits();
-        if(guest_total_visits > max_visits)
-        {
-            // the guest has the most visits -> clear honorable guests list
-            max_visits = guest_total_visits;
-            honorable_guests.clear();
-        }
-        // add guest to honorable guests if it has the most visits
-        if(guest_total_visits ==  max_visits)
-            honorable_guests.push_back(guest.first);
-    }
-
-    // sort the honorable guests alphabetically
-    sort(honorable_guests.begin(), honorable_guests.end());
+    // the first group has the guests with the most visits, already
+    // in alphabetical order
+    int max_visits = guests_by_visits_.begin()->first;
     cout << "With " << max_visits << " visit(s), the following guest(s) get(s) honorary award:" << endl;
     // go through all the honorable guests and print their names
-    for(const string& guest : honorable_guests)
+    for(const Person* guest : guests_by_visits_.begin()->second)
     {
-        cout << " * " << guest << endl;
+        cout << " * " << guest->name() << endl;
     }
 
 }
+/*
+ * Takes guests from the groups of the most visits until k are found.
+ */
+vector<const Person*> Hotel::top_guests(int k) const
+{
+    vector<const Person*> top;
+    for(const auto& group : guests_by_visits_)
+    {
+        for(const Person* guest : group.second)
+        {
+            if((int)top.size() >= k)
+                return top;
+            top.push_back(guest);
+        }
+    }
+    return top;
+}
 /*
  * Function that adds a room to the hotel
  */
@@ -356,4 +466,7 @@ void Hotel::add_room(int room_num, int size){
     new_room.current_visitors = 0;
 
     rooms_.push_back(new_room);
+    // a room with space can be booked right away
+    if(size > 0)
+        available_rooms_[size].insert({0, room_num, (int)rooms_.size() - 1});
 }
@@ -12,8 +12,13 @@
 #define HOTEL_HH
 
 #include "person.hh"
+#include <deque>
+#include <functional>
 #include <vector>
 #include <map>
+#include <set>
+#include <string_view>
+#include <unordered_map>
 
 using namespace std;
 using Params = const vector<string>&;
@@ -24,6 +29,32 @@ struct Room{
     int current_visitors = 0;
 };
 
+// A room with space in the availability index. Rooms are ordered
+// the way book chooses them: fewest visitors first, then by number.
+struct AvailableRoom{
+    int current_visitors;
+    int room_num;
+    // index of the room in rooms_
+    int index;
+
+    bool operator<(const AvailableRoom& other) const;
+};
+
+// Orders guests alphabetically by their names.
+struct GuestByName{
+    bool operator()(const Person* guest1, const Person* guest2) const;
+};
+
+// How book chooses a room when a guest asks for a room size.
+enum class AllocationPolicy{
+    // only rooms of exactly the size
+    EXACT,
+    // rooms of the smallest size that has space, at least the asked size
+    BEST_FIT,
+    // the room with the fewest visitors among sizes of at least the asked size
+    LEAST_LOADED
+};
+
 class Hotel
 {
 public:
@@ -56,6 +87,19 @@ public:
      */
     void advance_date(Params params);
 
+    /**
+     * @brief set_policy
+     * @param params vector containing parameters of the corresponding command
+     * Sets how rooms are chosen: exact, best-fit or least-loaded.
+     */
+    void set_policy(Params params);
+
+    /**
+     * @brief set_allocation_policy
+     * @param policy how book chooses rooms from now on
+     */
+    void set_allocation_policy(AllocationPolicy policy);
+
     /**
      * @brief print_rooms
      */
@@ -113,15 +157,50 @@ public:
      */
     void print_honor_guests(Params);
 
+    /**
+     * @brief top_guests
+     * @param k how many guests are wanted
+     * @return at most k guests with the most visits, most visits first.
+     * Guests with as many visits are in alphabetical order.
+     */
+    vector<const Person*> top_guests(int k) const;
 
 
 private:
     // helper function to get the first room by its requested size
     int get_first_room_by_size(int size);
+    // finds the room for the requested size with the allocation policy
+    int find_room(int size);
+    // finds the least loaded room of at least the requested size
+    int get_least_loaded_room(int size);
+    // changes the visitors of a room and keeps the availability index up to date
+    void change_visitors(int room_index, int change);
     // all rooms in the hotel
     vector<Room> rooms_;
-    // current hotel guests
-    map<string, Person> all_guests_;
+    // rooms that have space, by room size
+    map<int, set<AvailableRoom>> available_rooms_;
+    // how book chooses rooms
+    AllocationPolicy policy_ = AllocationPolicy::EXACT;
+    // every guest that has visited the hotel, in the order they first came.
+    // A deque never moves its elements, so the names stay in place.
+    deque<Person> guests_;
+    // indices of guests_ by name, the keys point to the names in guests_
+    unordered_map<string_view, int> guest_index_;
+    // guests in alphabetical order, built when printing
+    vector<const Person*> sorted_guests_;
+    // guests by their amount of visits, most visits first. Updated on
+    // each booking so the honor guests are known without going through
+    // every guest.
+    map<int, set<const Person*, GuestByName>, greater<int>> guests_by_visits_;
+
+    // finds a guest with a single hash lookup, nullptr if not found
+    Person* find_guest(string_view name);
+    // adds a guest that has not visited the hotel before
+    Person& add_guest(const string& name);
+    // gives all guests in alphabetical order
+    const vector<const Person*>& guests_by_name();
+    // moves a guest that just booked to the group of its new visit count
+    void count_visit(const Person* guest);
 
 };
 
@@ -1,6 +1,5 @@
 #include "person.hh"
 #include <string>
-#include <memory>
 #include <iostream>
 using namespace std;
 
@@ -12,20 +11,10 @@ Person::Person(string name)
 /*
  * A function that handles persons new visits
  */
-void Person::make_visit(shared_ptr<Visit>& visit)
+void Person::make_visit(Date start_date, int room_index)
 {
     staying = true;
-    total_visits_++;
-    if(first_visit_ == nullptr)
-    {
-        first_visit_ = visit;
-        last_visit_ = visit;
-    }
-    else
-    {
-        last_visit_->next_ = visit;
-        last_visit_ = visit;
-    }
+    visits_.push_back(Visit(start_date, room_index));
 }
 /*
  * Function that handles guest leaving
@@ -33,20 +22,18 @@ void Person::make_visit(shared_ptr<Visit>& visit)
 void Person::leave(Date leave_date)
 {
     staying = false;
-    last_visit_->leave(leave_date);
+    visits_.back().leave(leave_date);
 }
 /*
  * Function that prints all visits of a guest and their times
  */
 void Person::print() const
 {
-    shared_ptr<Visit> current = first_visit_;
-    while(current != nullptr)
+    for(const Visit& visit : visits_)
     {
         cout << "* Visit: ";
-        current->print_time();
+        visit.print_time();
         cout << endl;
-        current = current->next_;
     }
 }
 /*
@@ -54,5 +41,26 @@ void Person::print() const
  */
 int Person::visits() const
 {
-    return total_visits_;
+    return visits_.size();
+}
+/*
+ * A getter function for the name of the guest.
+ */
+const string& Person::name() const
+{
+    return name_;
+}
+/*
+ * Tells if the guest is in the hotel now.
+ */
+bool Person::is_staying() const
+{
+    return staying;
+}
+/*
+ * Returns the room index of the latest visit.
+ */
+int Person::last_room() const
+{
+    return visits_.back().room_number();
 }
@@ -2,7 +2,7 @@
 #define PERSON_HH
 
 #include <string>
-#include <memory>
+#include <vector>
 #include "visit.hh"
 #include "date.hh"
 
@@ -14,9 +14,10 @@ public:
 
     /**
      * @brief make_visit Creates a new visit
-     * @param visit shared pointer to the Visit class
+     * @param start_date the date when the guest arrived
+     * @param room_index index of the room of the visit
      */
-    void make_visit(std::shared_ptr<Visit>& visit);
+    void make_visit(Date start_date, int room_index);
 
     /**
      * @brief leave
@@ -38,18 +39,32 @@ public:
      */
     int visits() const;
 
+    /**
+     * @brief name
+     * @return name_
+     */
+    const std::string& name() const;
+
+    /**
+     * @brief is_staying
+     * @return true if the guest is currently in the hotel
+     */
+    bool is_staying() const;
+
+    /**
+     * @brief last_room
+     * @return room index of the latest visit
+     */
+    int last_room() const;
 
 private:
     // guests name
     std::string name_;
     bool staying = false;
-    int total_visits_ = 0;
-
-    // pointer to the last visit of the guest
-    std::shared_ptr<Visit> last_visit_ = nullptr;
 
-    // pointer to the first visit of the guest
-    std::shared_ptr<Visit> first_visit_ = nullptr;
+    // visits of the guest from the first to the latest, stored
+    // next to each other so going through them is cheap
+    std::vector<Visit> visits_;
 
 };
 
@@ -4,8 +4,7 @@
 using namespace std;
 
 Visit::Visit(Date start_date, int room_num)
-    : next_(nullptr),
-    start_(start_date),
+    : start_(start_date),
     room_number_(room_num)
 {
 }
@@ -16,7 +15,7 @@ Visit::~Visit()
 /*
  * Prints visit time in format start - end
  */
-void Visit::print_time()
+void Visit::print_time() const
 {
     start_.print();
     cout << " - ";
@@ -3,7 +3,6 @@
 
 #include "date.hh"
 #include <string>
-#include <memory>
 
 class Visit
 {
@@ -15,7 +14,7 @@ public:
      * @brief print_time
      * Prints the booking and end time of the visit
      */
-    void print_time();
+    void print_time() const;
 
     /**
      * @brief leave
@@ -30,11 +29,6 @@ public:
      */
     int room_number() const;
 
-    /**
-     * @brief next_ pointer to the next visit of a guest
-     */
-    std::shared_ptr<Visit> next_;
-
 private:
     // time when guest arrived
     Date start_;